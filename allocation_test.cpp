@@ -0,0 +1,78 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "solver.h"
+#include "puzzlefile.h"
+#include "allocations.h"
+
+
+// ==========================================================================
+// Checks that the search never touches the heap once it is set up: built
+// with the allocation hook (see allocations.h), a count and a solveFirst
+// must report no allocations from their workers, with every option that
+// sets aside memory of its own.  Run by make check.
+
+// puzzle6.txt
+static const char *puzzle =
+  "tile road road road road\n"
+  "tile road city pasture road\n"
+  "tile city road road pasture\n"
+  "tile pasture pasture city pasture\n"
+  "tile pasture pasture pasture city\n"
+  "tile pasture road road pasture\n"
+  "tile road pasture pasture road\n"
+  "tile pasture pasture road road\n"
+  "tile road road pasture pasture\n";
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+void checkSearches(const std::vector<Tile*> &tiles, const SolverOptions &options,
+                   const std::string &name) {
+  Solver solver(tiles, 5, 5, options);
+  solver.count();
+  check(solver.searchAllocations() == 0, name + ": count allocates");
+  solver.solveFirst();
+  check(solver.searchAllocations() == 0, name + ": solveFirst allocates");
+}
+
+
+// ==========================================================================
+int main() {
+  std::vector<Tile*> tiles;
+  std::string error;
+  unsigned long long before = AllocationCount();
+  if (!ParsePuzzle(puzzle, tiles, error)) {
+    std::cerr << "ERROR: " << error << std::endl;
+    return 1;
+  }
+  // without the hook every count would be 0 and prove nothing
+  if (AllocationCount() == before) {
+    std::cerr << "ERROR: not built with COUNT_ALLOCATIONS" << std::endl;
+    return 1;
+  }
+
+  SolverOptions options;
+  options.allow_rotations = true;
+  checkSearches(tiles, options, "plain");
+  options.tt_megabytes = 1;
+  checkSearches(tiles, options, "with a table");
+  options.backjump = options.nogoods = true;
+  checkSearches(tiles, options, "with nogoods");
+  options.threads = 3;
+  checkSearches(tiles, options, "on 3 threads");
+
+  for (int t = 0; t < tiles.size(); t++)
+    delete tiles[t];
+  if (failures > 0)
+    return 1;
+  std::cout << "allocations: ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,49 @@
+#include <cstdlib>
+#include <new>
+
+#include "allocations.h"
+
+
+// ==========================================================================
+// The replacement pair: every form of new goes through malloc and every
+// form of delete through free, sized and array forms included, or a
+// build with sized deallocation would free what this new allocated
+// through the library's own delete.
+#ifdef COUNT_ALLOCATIONS
+static thread_local unsigned long long allocation_count = 0;
+
+void* operator new(std::size_t n) {
+  allocation_count++;
+  void *p = std::malloc(n ? n : 1);
+  if (p == NULL) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t n) {
+  return operator new(n);
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+  std::free(p);
+}
+#endif
+
+unsigned long long AllocationCount() {
+#ifdef COUNT_ALLOCATIONS
+  return allocation_count;
+#else
+  return 0;
+#endif
+}
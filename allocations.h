@@ -0,0 +1,18 @@
+#ifndef __ALLOCATIONS_H__
+#define __ALLOCATIONS_H__
+
+
+// Debugging hook: built with -DCOUNT_ALLOCATIONS, allocations.cpp
+// replaces the global operator new and delete to count every heap
+// allocation, per thread.  The solver counts what its workers allocate
+// while they search, which after setup should be nothing at all (see
+// Solver::searchAllocations).  The replacement lives in a file of its
+// own, so the compiler never sees new and free inlined into one
+// function.
+
+// heap allocations made so far on the calling thread, always 0 without
+// the hook
+unsigned long long AllocationCount();
+
+
+#endif
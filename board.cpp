@@ -1,67 +1,290 @@
 #include <cassert>
 #include <cstdlib>
 #include <cstdio>
+#include <algorithm>
 
 #include "board.h"
-
-
-// this global variable is set in main.cpp and is adjustable from the command line
-// (you are not allowed to make your own global variables)
-extern int GLOBAL_TILE_SIZE;
+#include "renderer.h"
 
 
 // ==========================================================================
 // CONSTRUCTOR
-Board::Board(int i, int j) {
-  board = std::vector<std::vector<Tile*> >
-    ( (unsigned int)i,
-      std::vector<Tile*>((unsigned int)j,NULL) );
+Board::Board(int i, int j, const TileSet &s, int storage) : set(&s), rows(i), columns(j) {
+  assert (s.numTypes() < Placement::EMPTY);
+  assert (storage >= DENSE && storage <= AUTO);
+  if (storage == AUTO) {
+    storage = (long long)i*j > (long long)SPARSE_FACTOR * s.numTiles() ? SPARSE : DENSE;
+  }
+  sparse = (storage == SPARSE);
+  if (sparse) {
+    // a table at most half full keeps the probes short
+    int capacity = 16;
+    while (capacity < 2*s.numTiles()) capacity *= 2;
+    slot_cell = std::vector<int>(capacity, -1);
+    slot_placement = std::vector<Placement>(capacity);
+  } else {
+    cells = std::vector<Placement>((unsigned int)(i*j));
+  }
+
+  // every tile of the set starts out unplaced
+  supply_cities = supply_roads = 0;
+  for (int t = 0; t < s.numTypes(); t++) {
+    supply_cities += s.counts()[t] * s.type(t).numCities();
+    supply_roads += s.counts()[t] * s.type(t).numRoads();
+  }
+  clear();
 }
 
 
 // ==========================================================================
 // ACCESSORS
-Tile* Board::getTile(int i, int j) const {
+Placement Board::getPlacement(int i, int j) const {
   assert (i >= 0 && i < numRows());
   assert (j >= 0 && j < numColumns());
-  return board[i][j];
+  return at(i*columns+j);
+}
+
+Tile* Board::getTile(int i, int j) const {
+  Placement p = getPlacement(i,j);
+  if (p.empty()) return NULL;
+  return set->type(p.type).example();
+}
+
+bool Board::boundingBox(int &min_row, int &min_column, int &max_row, int &max_column) const {
+  if (occupied == 0) return false;
+  if (box_stale) {
+    box[0] = rows; box[1] = columns; box[2] = -1; box[3] = -1;
+    for (int k = 0; k < (sparse ? slot_cell.size() : cells.size()); k++) {
+      int cell = sparse ? slot_cell[k] : (cells[k].empty() ? -1 : k);
+      if (cell < 0) continue;
+      box[0] = std::min(box[0], cell / columns);
+      box[1] = std::min(box[1], cell % columns);
+      box[2] = std::max(box[2], cell / columns);
+      box[3] = std::max(box[3], cell % columns);
+    }
+    box_stale = false;
+  }
+  min_row = box[0];
+  min_column = box[1];
+  max_row = box[2];
+  max_column = box[3];
+  return true;
 }
 
 
 // ==========================================================================
 // MODIFIERS
-void Board::setTile(int i, int j, Tile* t) {
+void Board::setTile(int i, int j, Placement p) {
   assert (i >= 0 && i < numRows());
   assert (j >= 0 && j < numColumns());
-  //assert (t != NULL);
-  //assert (board[i][j] == NULL);
-  board[i][j] = t;
+  Placement cell = at(i*columns+j);
+  if (!cell.empty()) {
+    countEdges(i,j,cell,-1);
+    zobrist ^= placementKey(i,j,cell);
+    int type = cell.type;
+    zobrist ^= remainingKey(type,remaining[type]) ^ remainingKey(type,remaining[type]+1);
+    remaining[type]++;
+  }
+  store(i*columns+j, p);
+  if (!p.empty()) {
+    countEdges(i,j,p,+1);
+    zobrist ^= placementKey(i,j,p);
+    int type = p.type;
+    zobrist ^= remainingKey(type,remaining[type]) ^ remainingKey(type,remaining[type]-1);
+    remaining[type]--;
+  }
 }
 
 //==========================================
 void Board::clear(){
-  for(int i=0; i<board.size();i++){
-    for(int j=0; j<board[i].size(); j++){
-      board[i][j]=NULL;
+  for(int c=0; c<cells.size(); c++){
+    cells[c]=Placement();
+  }
+  for(int k=0; k<slot_cell.size(); k++){
+    slot_cell[k]=-1;
+  }
+  occupied = 0;
+  box_stale = false;
+  open_cities = open_roads = 0;
+  placed_cities = placed_roads = 0;
+  remaining = set->counts();
+  zobrist = 0;
+  for (int type = 0; type < set->numTypes(); type++) {
+    zobrist ^= remainingKey(type,remaining[type]);
+  }
+}
+
+// ==========================================================================
+// STORAGE
+// Every read and write of a cell goes through these two, whichever way
+// the board is stored.  A new tile can only grow the bounding box; a
+// removal may shrink it, which is left for boundingBox to find out.
+Placement Board::at(int cell) const {
+  if (!sparse) return cells[cell];
+  int slot = findSlot(cell);
+  return slot_cell[slot] < 0 ? Placement() : slot_placement[slot];
+}
+
+void Board::store(int cell, Placement p) {
+  Placement old;
+  if (!sparse) {
+    old = cells[cell];
+    cells[cell] = p;
+  } else {
+    int slot = findSlot(cell);
+    if (slot_cell[slot] >= 0) {
+      old = slot_placement[slot];
+      if (p.empty()) {
+        eraseSlot(slot);
+      } else {
+        slot_placement[slot] = p;
+      }
+    } else if (!p.empty()) {
+      slot_cell[slot] = cell;
+      slot_placement[slot] = p;
+      if (2*(occupied+1) > slot_cell.size()) {
+        growTable();
+      }
+    }
+  }
+  if (!old.empty()) {
+    occupied--;
+    box_stale = true;
+  }
+  if (!p.empty()) {
+    occupied++;
+    int r = cell / columns;
+    int c = cell % columns;
+    if (occupied == 1) {
+      box[0] = box[2] = r;
+      box[1] = box[3] = c;
+      box_stale = false;
+    } else if (!box_stale) {
+      box[0] = std::min(box[0], r);
+      box[1] = std::min(box[1], c);
+      box[2] = std::max(box[2], r);
+      box[3] = std::max(box[3], c);
     }
   }
 }
+
 // ==========================================================================
-// PRINTING
-void Board::Print() const {
-  for (int b = 0; b < numRows(); b++) {
-    for (int i = 0; i < GLOBAL_TILE_SIZE; i++) {
-      for (int j = 0; j < numColumns(); j++) {
-        if (board[b][j] != NULL) {
-          board[b][j]->rotate(board[b][j]->getRotation()).printRow(std::cout,i);
-        } else {
-          std::cout << std::string(GLOBAL_TILE_SIZE,' ');
-        }
+// SPARSE STORAGE
+// Linear probing from a hash of the cell index.  The table is a power of
+// two in size and kept at most half full, so a probe sequence always ends
+// at an empty slot.
+static int HomeSlot(int cell, int size) {
+  unsigned int x = (unsigned int)cell * 0x9e3779b1u;
+  return (x ^ (x >> 16)) & (size-1);
+}
+
+// the slot holding the cell, or the empty slot where it would go
+int Board::findSlot(int cell) const {
+  int size = slot_cell.size();
+  int slot = HomeSlot(cell, size);
+  while (slot_cell[slot] >= 0 && slot_cell[slot] != cell) {
+    slot = (slot+1) & (size-1);
+  }
+  return slot;
+}
+
+// Empties the slot and moves back any later entry of the same run that
+// could no longer be reached across the gap, so no tombstones are needed.
+void Board::eraseSlot(int slot) {
+  int size = slot_cell.size();
+  int next = slot;
+  for (;;) {
+    next = (next+1) & (size-1);
+    if (slot_cell[next] < 0) break;
+    int home = HomeSlot(slot_cell[next], size);
+    // the entry stays if its home is cyclically in (slot, next]
+    bool stays = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+    if (stays) continue;
+    slot_cell[slot] = slot_cell[next];
+    slot_placement[slot] = slot_placement[next];
+    slot = next;
+  }
+  slot_cell[slot] = -1;
+}
+
+// only when more tiles are put down than the set has, which the solver
+// never does
+void Board::growTable() {
+  std::vector<int> old_cell;
+  std::vector<Placement> old_placement;
+  old_cell.swap(slot_cell);
+  old_placement.swap(slot_placement);
+  slot_cell = std::vector<int>(2*old_cell.size(), -1);
+  slot_placement = std::vector<Placement>(2*old_cell.size());
+  for (int k = 0; k < old_cell.size(); k++) {
+    if (old_cell[k] < 0) continue;
+    int slot = findSlot(old_cell[k]);
+    slot_cell[slot] = old_cell[k];
+    slot_placement[slot] = old_placement[k];
+  }
+}
+
+// ==========================================================================
+// Each side of the tile either closes a neighbor's open edge, or (if the
+// neighboring cell is empty or off the board) is itself left open.
+void Board::countEdges(int i, int j, Placement p, int sign) {
+  static const int di[4] = { -1, 0, 1, 0 };
+  static const int dj[4] = { 0, 1, 0, -1 };
+  const TileType &type = set->type(p.type);
+  int open = type.openEdges(p.degrees());
+  int city = type.cityEdges(p.degrees());
+  for (int s = 0; s < 4; s++) {
+    int side = 1 << s;
+    int facing = 1 << ((s+2)%4);
+    Placement n;
+    if (!(borderMask(i,j) & side)) {
+      n = at((i+di[s])*columns+j+dj[s]);
+    }
+    if (!n.empty()) {
+      // the neighbor's side facing us is no longer (or again) open
+      const TileType &other = set->type(n.type);
+      if (other.cityEdges(n.degrees()) & facing) {
+        open_cities -= sign;
+      } else if (other.openEdges(n.degrees()) & facing) {
+        open_roads -= sign;
       }
-      std::cout << "\n";
+    } else if (city & side) {
+      open_cities += sign;
+    } else if (open & side) {
+      open_roads += sign;
     }
   }
-  fflush(stdout);
+  placed_cities += sign * type.numCities();
+  placed_roads += sign * type.numRoads();
+}
+
+// ==========================================================================
+// HASHING
+// the keys come from the splitmix64 finalizer, which is as good as a
+// table of random numbers and needs no memory however large the board
+static unsigned long long mix(unsigned long long x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+unsigned long long Board::placementKey(int i, int j, Placement p) const {
+  unsigned long long cell = (unsigned long long)i * numColumns() + j;
+  return mix((cell * 81 + set->type(p.type).signature()) * 4 + p.rotation);
+}
+
+unsigned long long Board::remainingKey(int type, int count) const {
+  return mix(~((unsigned long long)count * 81 + set->type(type).signature()));
+}
+
+// ==========================================================================
+// PRINTING
+// callers printing many boards should keep their own BoardRenderer so
+// its buffer is reused
+void Board::Print(const RenderContext &context) const {
+  BoardRenderer renderer(context);
+  renderer.print(*this, std::cout);
 }
 
 // ==========================================================================
@@ -3,35 +3,124 @@
 
 #include <vector>
 #include "tile.h"
+#include "tileset.h"
 
 
-// This class stores a grid of Tile pointers, which are NULL if the
-// grid location does not (yet) contain a tile
+// Tiny all-public class recording what sits in one board cell: a TileSet
+// type id and how far the tile is turned.  It is two bytes and has no
+// pointers, so a whole board copies as a block of memory.
+class Placement {
+public:
+  Placement() : type(EMPTY), rotation(0) {}
+  Placement(int t, int rot) : type(t), rotation(rot/90) {}
+  bool empty() const { return type == EMPTY; }
+  int degrees() const { return rotation*90; }
+  enum { EMPTY = 255 };
+  unsigned char type;      // TileSet type id, or EMPTY
+  unsigned char rotation;  // clockwise quarter turns, 0-3
+};
+
+
+// This class stores a grid of Placements, which are empty if the grid
+// location does not (yet) contain a tile.  It also keeps a running
+// tally of the road & city edges that are still waiting for a neighbor
+// (demand) and of those still available on the unplaced tiles (supply),
+// and a Zobrist hash of the partial layout.
+//
+// A board much larger than its tile set is stored sparse: only the
+// occupied cells are kept, in an open-addressing hash table sized by the
+// number of tiles, so memory does not grow with the board and a lookup
+// is still a probe or two.  Either way the board knows the bounding box
+// of its tiles, so whoever walks the layout can skip the empty rest.
 
 class Board {
 public:
 
+  // how the cells are stored; AUTO picks SPARSE when the board has many
+  // times more cells than the set has tiles
+  enum { DENSE = 0, SPARSE, AUTO };
+  enum { SPARSE_FACTOR = 64 };
+
   // CONSTRUCTOR
-  // takes in the dimensions (height & width) of the board
-  Board(int i, int j);
+  // takes in the dimensions (height & width) of the board and the tile
+  // set whose type ids the placements refer to
+  Board(int i, int j, const TileSet &set, int storage = AUTO);
 
   // ACCESSORS
-  int numRows() const { return board.size(); }
-  int numColumns() const { return board[0].size(); }
+  int numRows() const { return rows; }
+  int numColumns() const { return columns; }
+  const TileSet& tileSet() const { return *set; }
+  bool isSparse() const { return sparse; }
+  Placement getPlacement(int i, int j) const;
+  // a tile with the edges of the placed type (unrotated), NULL if empty
   Tile* getTile(int i, int j) const;
-  std::vector<Tile*>& operator[] (int i) { return board[i];}
+  // rotation in degrees of the tile at (i,j)
+  int getRotation(int i, int j) const { return getPlacement(i,j).degrees(); }
+  // sides of cell (i,j) that face off the board (NORTH_EDGE, etc.)
+  int borderMask(int i, int j) const {
+    return (i == 0 ? NORTH_EDGE : 0) | (j == columns-1 ? EAST_EDGE : 0) |
+           (i == rows-1 ? SOUTH_EDGE : 0) | (j == 0 ? WEST_EDGE : 0);
+  }
+  // the smallest rectangle holding every tile, false if there are none
+  bool boundingBox(int &min_row, int &min_column, int &max_row, int &max_column) const;
+  // road & city sides of placed tiles not yet closed by a neighbor
+  int openCities() const { return open_cities; }
+  int openRoads() const { return open_roads; }
+  // road & city sides left on the tiles that are not on the board
+  int remainingCities() const { return supply_cities - placed_cities; }
+  int remainingRoads() const { return supply_roads - placed_roads; }
+  // tiles of type t not on the board
+  int numRemaining(int t) const { return remaining[t]; }
+  // Zobrist hash over (cell, tile type, rotation) of every placement,
+  // combined with the multiset of tile types not yet placed
+  unsigned long long hash() const { return zobrist; }
+  // the key one placement adds to the hash
+  unsigned long long placementKey(int i, int j, Placement p) const;
 
   // MODIFIERS
-  void setTile(int i, int j, Tile* t);
+  // an empty Placement removes the tile at (i,j)
+  void setTile(int i, int j, Placement p);
   void clear();
 
   // FOR PRINTING
-  void Print() const;
+  void Print(const RenderContext &context = RenderContext()) const;
 
 private:
 
+  // the placement in cell i*columns+j, and the one place it is written
+  Placement at(int cell) const;
+  void store(int cell, Placement p);
+  // helpers for the sparse table, see SPARSE STORAGE in board.cpp
+  int findSlot(int cell) const;
+  void eraseSlot(int slot);
+  void growTable();
+  // helper for setTile, sign is +1 to add a placement or -1 to remove it
+  void countEdges(int i, int j, Placement p, int sign);
+  // helper for the hash, one pseudo-random key per (tile type, number
+  // left) pair
+  unsigned long long remainingKey(int type, int count) const;
+
   // REPRESENTATION
-  std::vector<std::vector<Tile*> > board;
+  const TileSet *set;
+  int rows;
+  int columns;
+  bool sparse;
+  std::vector<Placement> cells;          // dense: one per cell, row-major
+  std::vector<int> slot_cell;            // sparse: cell in each slot, or -1
+  std::vector<Placement> slot_placement; // sparse: what is in that cell
+  int occupied;                          // cells holding a tile
+  // bounding box of the tiles; a removal can shrink it, so it is only
+  // worked out again when asked for
+  mutable bool box_stale;
+  mutable int box[4];                    // min row, min column, max row, max column
+  int open_cities;
+  int open_roads;
+  int placed_cities;
+  int placed_roads;
+  int supply_cities;
+  int supply_roads;
+  std::vector<int> remaining;
+  unsigned long long zobrist;
 };
 
 
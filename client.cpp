@@ -0,0 +1,91 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include "framedsocket.h"
+
+
+// ==========================================================================
+// A tiny client for the solver daemon (carcassonne -serve).  It sends one
+// puzzle file with the options after it, prints every message that comes
+// back until the request is done, and with -cancel_after cancels the
+// request once that many seconds have passed.
+void usage(int argc, char *argv[]) {
+  std::cerr << "USAGE: " << std::endl;
+  std::cerr << "  " << argv[0] << " <socket> <filename>  -board_dimensions <h> <w>  [options]" << std::endl;
+  std::cerr << "  " << argv[0] << " <socket> <filename>  -cancel_after <seconds>  [options]" << std::endl;
+  exit(1);
+}
+
+
+// ==========================================================================
+// waits, then cancels the request; sending is safe from a second thread
+void CancelAfter(FramedSocket *socket, double seconds) {
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  socket->send("cancel 1");
+}
+
+
+// ==========================================================================
+int main(int argc, char *argv[]) {
+
+  if (argc < 3) {
+    usage(argc,argv);
+  }
+  std::string path = argv[1];
+  std::string filename = argv[2];
+
+  // everything but our own option goes to the daemon as it is
+  std::string options;
+  double cancel_after = 0;
+  for (int i = 3; i < argc; i++) {
+    if (argv[i] == std::string("-cancel_after")) {
+      i++;
+      if (i >= argc || (cancel_after = atof(argv[i])) <= 0) {
+        std::cerr << "ERROR: bad cancel_after" << std::endl;
+        usage(argc,argv);
+      }
+    } else {
+      options += std::string(" ") + argv[i];
+    }
+  }
+
+  std::ifstream istr(filename.c_str());
+  if (!istr) {
+    std::cerr << "ERROR: cannot open file '" << filename << "'" << std::endl;
+    usage(argc,argv);
+  }
+  std::ostringstream puzzle;
+  puzzle << istr.rdbuf();
+
+  int fd = FramedSocket::connectTo(path);
+  if (fd < 0) {
+    std::cerr << "ERROR: cannot connect to '" << path << "'" << std::endl;
+    usage(argc,argv);
+  }
+  FramedSocket socket(fd);
+  if (!socket.send("solve 1" + options + "\n" + puzzle.str())) {
+    std::cerr << "ERROR: the daemon went away" << std::endl;
+    return 1;
+  }
+  if (cancel_after > 0) {
+    std::thread(CancelAfter, &socket, cancel_after).detach();
+  }
+
+  // the request is answered with "done 1 ..." after any solutions
+  std::string message;
+  while (socket.receive(message)) {
+    std::cout << message << '\n';
+    if (message.compare(0, 7, "done 1 ") == 0) {
+      std::cout.flush();
+      return message.compare(7, 5, "error") == 0 ? 1 : 0;
+    }
+  }
+  std::cerr << "ERROR: the daemon went away" << std::endl;
+  return 1;
+}
+// ==========================================================================
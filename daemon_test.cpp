@@ -0,0 +1,172 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "framedsocket.h"
+
+
+// ==========================================================================
+// Checks that a client which stops reading cannot hold on to the daemon.
+// A send with a timeout to a peer that takes nothing gives up once the
+// timeout passes, and drops the connection.  Then, with a daemon of one
+// thread, a client asks for all the solutions of a big puzzle and reads
+// none of them; its connection must be dropped once its request's time
+// limit is up, and a second client must still get its answer.  Run by
+// make check with the build directory, where carcassonne is.
+
+// puzzle3.txt, which with rotations has solutions by the million on a
+// big board
+static const char *many =
+  "tile road road pasture pasture\n"
+  "tile road road pasture pasture\n"
+  "tile road road pasture pasture\n"
+  "tile road road pasture pasture\n";
+
+// puzzle1.txt
+static const char *few =
+  "tile road road pasture pasture\n"
+  "tile road pasture pasture road\n"
+  "tile pasture pasture road road\n"
+  "tile pasture road road pasture\n";
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// a receive on the socket fails after this many seconds without data
+void receiveTimeout(int fd, int seconds) {
+  timeval limit;
+  limit.tv_sec = seconds;
+  limit.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof(limit));
+}
+
+void checkSendTimeout() {
+  int fds[2];
+  socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  FramedSocket sender(fds[0]);
+  FramedSocket stalled(fds[1]);
+  std::string message(1 << 16, 'x');
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  int sent = 0;
+  while (sent < 1000 && sender.send(message, 0.5))
+    sent++;
+  double waited = secondsSince(start);
+  check(sent < 1000, "a peer that reads nothing is dropped");
+  check(waited >= 0.4 && waited < 5, "the send gives up after its timeout");
+  check(!sender.send("more", 0.5) && !sender.send("more"), "every send after a drop fails");
+
+  // the frames that went out whole can still be read, then the stream ends
+  receiveTimeout(fds[1], 5);
+  std::string received;
+  int whole = 0;
+  while (stalled.receive(received))
+    whole++;
+  check(whole == sent, "the peer reads the frames sent before the drop, then the end");
+}
+
+// starts the daemon on the socket and waits until it takes connections
+pid_t startDaemon(const std::string &program, const std::string &path) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    int quiet = open("/dev/null", O_WRONLY);
+    dup2(quiet, 2);
+    execl(program.c_str(), program.c_str(), "-serve", path.c_str(), "-threads", "1", (char*)NULL);
+    _exit(127);
+  }
+  for (int tries = 0; tries < 100; tries++) {
+    int fd = FramedSocket::connectTo(path);
+    if (fd >= 0) {
+      close(fd);
+      return pid;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return pid;
+}
+
+void checkStalledClient(const std::string &build) {
+  std::ostringstream unique;
+  unique << "/tmp/daemon_test." << getpid() << ".socket";
+  std::string path = unique.str();
+  pid_t daemon = startDaemon(build + "/carcassonne", path);
+
+  // the first client takes up the daemon's only thread and reads nothing
+  int stalled_fd = FramedSocket::connectTo(path);
+  check(stalled_fd >= 0, "connect to the daemon");
+  if (stalled_fd < 0) {
+    kill(daemon, SIGKILL);
+    waitpid(daemon, NULL, 0);
+    return;
+  }
+  int small = 4096;
+  setsockopt(stalled_fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+  FramedSocket stalled(stalled_fd);
+  stalled.send(std::string("solve 1 -board_dimensions 300 300 -allow_rotations -all_solutions "
+                           "-time_limit 2\n") + many);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // the second client is answered once the first is dropped
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  int fd = FramedSocket::connectTo(path);
+  receiveTimeout(fd, 30);
+  FramedSocket client(fd);
+  client.send(std::string("solve 2 -board_dimensions 3 3 -count_only\n") + few);
+  std::string answer;
+  while (client.receive(answer) && answer.compare(0, 7, "done 2 ") != 0) {}
+  check(answer == "done 2 count 4", "the second client is answered: '" + answer + "'");
+  check(secondsSince(start) < 15, "the second client is answered soon after the time limit");
+
+  // what reached the stalled client before the drop is all solutions,
+  // with no answer after them
+  receiveTimeout(stalled_fd, 30);
+  std::string message;
+  std::string last;
+  while (stalled.receive(message))
+    last = message;
+  check(last.compare(0, 11, "solution 1 ") == 0, "the stalled client is dropped: '" + last.substr(0, 40) + "'");
+
+  kill(daemon, SIGTERM);
+  waitpid(daemon, NULL, 0);
+  unlink(path.c_str());
+}
+
+
+// a send or a daemon that never gives up would leave the test stuck
+void stuck(int) {
+  static const char message[] = "FAILED: still stuck after a minute\n";
+  write(2, message, sizeof(message)-1);
+  _exit(1);
+}
+
+
+// ==========================================================================
+int main(int argc, char *argv[]) {
+  std::string build = argc > 1 ? argv[1] : "build";
+  signal(SIGALRM, stuck);
+  alarm(60);
+  checkSendTimeout();
+  checkStalledClient(build);
+  if (failures > 0)
+    return 1;
+  std::cout << "daemon: ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,150 @@
+#include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <chrono>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "framedsocket.h"
+
+
+// ==========================================================================
+// CONSTRUCTOR & DESTRUCTOR
+FramedSocket::FramedSocket(int f) : fd(f), dropped(false) {
+  assert (fd >= 0);
+}
+
+FramedSocket::~FramedSocket() {
+  close(fd);
+}
+
+
+// ==========================================================================
+// helper for listenAt and connectTo, false if the path does not fit
+static bool SocketAddress(const std::string &path, sockaddr_un &address) {
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+  memcpy(address.sun_path, path.c_str(), path.size()+1);
+  return true;
+}
+
+int FramedSocket::listenAt(const std::string &path) {
+  sockaddr_un address;
+  if (!SocketAddress(path, address)) return -1;
+  int s = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (s < 0) return -1;
+  unlink(path.c_str());
+  if (bind(s, (sockaddr*)&address, sizeof(address)) < 0 || listen(s, 16) < 0) {
+    close(s);
+    return -1;
+  }
+  return s;
+}
+
+int FramedSocket::connectTo(const std::string &path) {
+  sockaddr_un address;
+  if (!SocketAddress(path, address)) return -1;
+  int s = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (s < 0) return -1;
+  if (connect(s, (sockaddr*)&address, sizeof(address)) < 0) {
+    close(s);
+    return -1;
+  }
+  return s;
+}
+
+int FramedSocket::acceptFrom(int listener) {
+  for (;;) {
+    int s = accept(listener, NULL, NULL);
+    if (s >= 0 || errno != EINTR) return s;
+  }
+}
+
+
+// ==========================================================================
+// SENDING
+// helper for send: waits until the socket can take more bytes, false if
+// the deadline passes first
+static bool WaitWritable(int fd, std::chrono::steady_clock::time_point deadline) {
+  for (;;) {
+    std::chrono::steady_clock::duration left = deadline - std::chrono::steady_clock::now();
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(left).count() + 1;
+    pollfd p;
+    p.fd = fd;
+    p.events = POLLOUT;
+    p.revents = 0;
+    int n = poll(&p, 1, ms > 0 ? (int)std::min(ms, 1LL << 30) : 0);
+    if (n < 0 && errno == EINTR) continue;
+    // an error or a hang-up is left for the send to report
+    return n != 0;
+  }
+}
+
+// MSG_NOSIGNAL turns a closed connection into an error instead of
+// SIGPIPE.  With a timeout the socket is only written once poll says it
+// has room, and without blocking, so the deadline holds however little
+// room there is.
+bool FramedSocket::send(const std::string &message, double timeout) {
+  std::string frame = std::to_string(message.size()) + '\n' + message;
+  std::lock_guard<std::mutex> guard(send_lock);
+  if (dropped) return false;
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+  int flags = MSG_NOSIGNAL | (timeout >= 0 ? MSG_DONTWAIT : 0);
+  size_t sent = 0;
+  while (sent < frame.size()) {
+    if (timeout >= 0 && !WaitWritable(fd, deadline)) {
+      dropped = true;
+      shutdown(fd, SHUT_RDWR);
+      return false;
+    }
+    ssize_t n = ::send(fd, frame.data()+sent, frame.size()-sent, flags);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+    if (n <= 0) return false;
+    sent += n;
+  }
+  return true;
+}
+
+void FramedSocket::shutdownSend() {
+  shutdown(fd, SHUT_WR);
+}
+
+
+// ==========================================================================
+// RECEIVING
+bool FramedSocket::receive(std::string &message) {
+  size_t length = 0;
+  size_t header = std::string::npos;
+  for (;;) {
+    if (header == std::string::npos) {
+      header = received.find('\n');
+      if (header != std::string::npos) {
+        // the length has to be a plain decimal number
+        if (header == 0 || header > 9 ||
+            received.find_first_not_of("0123456789") < header) return false;
+        length = atol(received.substr(0,header).c_str());
+        if (length > MAX_MESSAGE) return false;
+      } else if (received.size() > 9) {
+        return false;
+      }
+    }
+    if (header != std::string::npos && received.size() >= header+1+length) {
+      message = received.substr(header+1, length);
+      received.erase(0, header+1+length);
+      return true;
+    }
+    char buffer[65536];
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    received.append(buffer, n);
+  }
+}
+
+// ==========================================================================
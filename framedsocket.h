@@ -0,0 +1,60 @@
+#ifndef __FRAMEDSOCKET_H__
+#define __FRAMEDSOCKET_H__
+
+#include <string>
+#include <mutex>
+
+
+// This class sends and receives whole messages over a connected
+// Unix-domain stream socket.  Each message goes out as a frame: its
+// length in bytes as a decimal number and a newline, then the bytes
+// themselves.  Any thread may send, and sends never interleave; one
+// thread at a time may receive.  The socket is closed with the object.
+//
+// A send may be given a timeout.  If the other end does not take the
+// whole frame in time, the connection is dropped, since half a frame
+// cannot be taken back: every later send fails, and a receive sees the
+// end of the stream.
+
+class FramedSocket {
+public:
+
+  // CONSTRUCTOR & DESTRUCTOR
+  // takes over a connected socket
+  FramedSocket(int fd);
+  ~FramedSocket();
+
+  // a socket listening at path, replacing any old socket file, or -1
+  static int listenAt(const std::string &path);
+  // a socket connected to the one listening at path, or -1
+  static int connectTo(const std::string &path);
+  // waits for the next connection to a listening socket, -1 on failure
+  static int acceptFrom(int listener);
+
+  // sends one message, false once the other end has gone or the
+  // connection was dropped; a negative timeout waits as long as it takes
+  bool send(const std::string &message, double timeout = -1);
+  // waits for the next message, false at the end of the stream or on a
+  // frame that makes no sense
+  bool receive(std::string &message);
+  // no more messages will be sent; the other end sees the end of the stream
+  void shutdownSend();
+
+  // frames longer than this are refused
+  enum { MAX_MESSAGE = 64 << 20 };
+
+private:
+
+  // the socket is closed once, so it must not be copied
+  FramedSocket(const FramedSocket&);
+  FramedSocket& operator=(const FramedSocket&);
+
+  // REPRESENTATION
+  int fd;
+  std::mutex send_lock;
+  bool dropped;           // guarded by send_lock
+  std::string received;   // bytes read past the last message returned
+};
+
+
+#endif
@@ -2,20 +2,22 @@
 #include "location.h"
 
 
-Location::Location (int r, int c, int rot) : row(r), column(c), rotation(rot) { 
-  assert (rotation == 0 || 
-          rotation == 90 || 
-          rotation == 180 || 
-          rotation == 270); 
+Location::Location (int r, int c, int rot) : row(r), column(c), turns(rot/90) { 
+  assert (r >= 0 && r <= MAX_COORDINATE);
+  assert (c >= 0 && c <= MAX_COORDINATE);
+  assert (rot == 0 || 
+          rot == 90 || 
+          rot == 180 || 
+          rot == 270); 
 }
 
 bool operator==(const Location &loc1, const Location &loc2) {
   return (loc1.row      == loc2.row      && 
           loc1.column   == loc2.column   && 
-          loc1.rotation == loc2.rotation );
+          loc1.turns    == loc2.turns    );
 }
 
 std::ostream& operator<<(std::ostream &ostr, const Location &loc) {
-  ostr << "(" << loc.row << "," << loc.column << "," << loc.rotation << ")";
+  ostr << "(" << loc.row << "," << loc.column << "," << loc.rotation() << ")";
   return ostr;
 }
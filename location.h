@@ -5,13 +5,16 @@
 
 
 // Tiny all-public class to store the grid coordinates and rotation
-// for placing a tile onto the board
+// for placing a tile onto the board.  The fields are packed into 32
+// bits, so solutions can be stored by the thousand without much memory.
 class Location {
 public:
   Location (int r, int c, int rot);
-  int row;
-  int column;
-  int rotation; // should be 0, 90, 180, or 270
+  int rotation() const { return turns*90; } // 0, 90, 180, or 270
+  enum { MAX_COORDINATE = (1<<15)-1 };
+  unsigned int row : 15;
+  unsigned int column : 15;
+  unsigned int turns : 2;  // clockwise quarter turns
   //int findPosition(int r, int c);
 };
 
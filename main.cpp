@@ -4,18 +4,30 @@
 #include <cstdlib>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <cassert>
+#include <sstream>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <condition_variable>
 
 #include "MersenneTwister.h"
 
 #include "tile.h"
 #include "location.h"
 #include "board.h"
-
-
-// this global variable is set in main.cpp and is adjustable from the command line
-// (you are not allowed to make your own global variables)
-int GLOBAL_TILE_SIZE = 11;
+#include "tileset.h"
+#include "solver.h"
+#include "framedsocket.h"
+#include "puzzlefile.h"
+#include "resultcache.h"
+#include "solutionfile.h"
+#include "solutionpipe.h"
 
 
 // ==========================================================================
@@ -28,6 +40,19 @@ void usage(int argc, char *argv[]) {
   std::cerr << "  " << argv[0] << " <filename>  -board_dimensions <h> <w>  -allow_rotations" << std::endl;
   std::cerr << "  " << argv[0] << " <filename>  -all_solutions  -allow_rotations" << std::endl;
   std::cerr << "  " << argv[0] << " <filename>  -tile_size <odd # >= 11>" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -board_dimensions <h> <w>  -count_only" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -tt_mb <megabytes, 0 = off>" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -cell_order <queue|fewest|edges>" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -backjump  [-nogoods]" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -threads <n>  [-deterministic]" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -portfolio <n>" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -restarts <luby|geometric>  -restart_nodes <n>" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -seed <n>" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -time_limit <seconds>" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -cache <directory>  [-cache_mb <n>]" << std::endl;
+  std::cerr << "  " << argv[0] << " <filename>  -board_dimensions <h> <w>  -all_solutions  -binary_output <file>" << std::endl;
+  std::cerr << "  " << argv[0] << " -batch <manifest>  -threads <n>  [options for every job]" << std::endl;
+  std::cerr << "  " << argv[0] << " -serve <socket>  -threads <n>  [options for every request]" << std::endl;
   exit(1);
 }
 
@@ -37,12 +62,12 @@ void usage(int argc, char *argv[]) {
 // To get you started, this function places tiles on the board and
 // randomly and outputs the results (in all likelihood *not* a
 // solution!) in the required format
-void RandomlyPlaceTiles(Board &board, const std::vector<Tile*> &tiles, std::vector<Location> &locations) {
+void RandomlyPlaceTiles(Board &board, const TileSet &tiles, std::vector<Location> &locations) {
 
   // MersenneTwister is an excellent library for psuedo-random numbers!
   MTRand mtrand;
 
-  for (int t = 0; t < tiles.size(); t++) {
+  for (int t = 0; t < tiles.numTiles(); t++) {
     // loop generates random locations until we (eventually) find one
     // that is not occupied
     int i,j;
@@ -54,652 +79,832 @@ void RandomlyPlaceTiles(Board &board, const std::vector<Tile*> &tiles, std::vect
 
     // rotation is always 0 (for now)
     locations.push_back(Location(i,j,0));
-    board.setTile(i,j,tiles[t]);
+    board.setTile(i,j,Placement(tiles.typeOf(t),0));
   }
 }
 
 
 // ==========================================================================
-void HandleCommandLineArguments(int argc, char *argv[], std::string &filename, 
-                                int &rows, int &columns, bool &all_solutions, bool &allow_rotations) {
+// helper for ParseOptions: moves i on to the value of option args[i],
+// false if there is none
+bool NextValue(const std::vector<std::string> &args, int &i, std::string &error) {
+  if (i+1 >= args.size()) {
+    error = "missing value after " + args[i];
+    return false;
+  }
+  i++;
+  return true;
+}
+
+// Parses the options that follow the puzzle file, from the command line
+// or from one line of a batch manifest.  Returns false, with the reason
+// in error, if they make no sense.
+bool ParseOptions(const std::vector<std::string> &args, int &rows, int &columns,
+                  bool &all_solutions, bool &count_only, SolverOptions &options,
+                  RenderContext &context, std::string &error) {
+  for (int i = 0; i < args.size(); i++) {
+    if (args[i] == "-tile_size") {
+      if (!NextValue(args,i,error)) return false;
+      context.tile_size = atoi(args[i].c_str());
+      if (!RenderContext::validTileSize(context.tile_size)) {
+        error = "bad tile_size";
+        return false;
+      }
+    } else if (args[i] == "-all_solutions") {
+      all_solutions = true;
+    } else if (args[i] == "-board_dimensions") {
+      if (!NextValue(args,i,error)) return false;
+      rows = atoi(args[i].c_str());
+      if (!NextValue(args,i,error)) return false;
+      columns = atoi(args[i].c_str());
+      if (rows < 1 || columns < 1 ||
+          rows > Location::MAX_COORDINATE+1 || columns > Location::MAX_COORDINATE+1) {
+        error = "bad board_dimensions";
+        return false;
+      }
+    } else if (args[i] == "-allow_rotations") {
+      options.allow_rotations = true;
+    } else if (args[i] == "-count_only") {
+      count_only = true;
+    } else if (args[i] == "-tt_mb") {
+      if (!NextValue(args,i,error)) return false;
+      options.tt_megabytes = atoi(args[i].c_str());
+      if (options.tt_megabytes < 0) {
+        error = "bad tt_mb";
+        return false;
+      }
+    } else if (args[i] == "-threads") {
+      if (!NextValue(args,i,error)) return false;
+      options.threads = atoi(args[i].c_str());
+      if (options.threads < 1) {
+        error = "bad threads";
+        return false;
+      }
+    } else if (args[i] == "-time_limit") {
+      if (!NextValue(args,i,error)) return false;
+      options.time_limit = atof(args[i].c_str());
+      if (options.time_limit <= 0) {
+        error = "bad time_limit";
+        return false;
+      }
+    } else if (args[i] == "-portfolio") {
+      if (!NextValue(args,i,error)) return false;
+      options.portfolio = atoi(args[i].c_str());
+      if (options.portfolio < 1) {
+        error = "bad portfolio";
+        return false;
+      }
+    } else if (args[i] == "-restarts") {
+      if (!NextValue(args,i,error)) return false;
+      if (args[i] == "luby") {
+        options.restarts = RESTARTS_LUBY;
+      } else if (args[i] == "geometric") {
+        options.restarts = RESTARTS_GEOMETRIC;
+      } else {
+        error = "bad restarts";
+        return false;
+      }
+    } else if (args[i] == "-restart_nodes") {
+      if (!NextValue(args,i,error)) return false;
+      options.restart_nodes = atoi(args[i].c_str());
+      if (options.restart_nodes < 1) {
+        error = "bad restart_nodes";
+        return false;
+      }
+    } else if (args[i] == "-seed") {
+      if (!NextValue(args,i,error)) return false;
+      options.seed = atoi(args[i].c_str());
+      if (options.seed < 0) {
+        error = "bad seed";
+        return false;
+      }
+    } else if (args[i] == "-deterministic") {
+      options.deterministic = true;
+    } else if (args[i] == "-backjump") {
+      options.backjump = true;
+    } else if (args[i] == "-nogoods") {
+      // nogoods are learned from the conflict sets backjumping builds
+      options.backjump = true;
+      options.nogoods = true;
+    } else if (args[i] == "-cell_order") {
+      if (!NextValue(args,i,error)) return false;
+      if (args[i] == "queue") {
+        options.cell_order = ORDER_QUEUE;
+      } else if (args[i] == "fewest") {
+        options.cell_order = ORDER_FEWEST;
+      } else if (args[i] == "edges") {
+        options.cell_order = ORDER_EDGES;
+      } else {
+        error = "bad cell_order";
+        return false;
+      }
+    } else {
+      error = "unknown argument '" + args[i] + "'";
+      return false;
+    }
+  }
+  // the solvers of a portfolio race to the first solution
+  if (options.portfolio > 0 &&
+      (all_solutions || count_only || options.deterministic || options.threads > 1)) {
+    error = "-portfolio only finds a first solution, one thread per solver";
+    return false;
+  }
+  // a restarted search is only repeatable on one thread
+  if (options.restarts != RESTARTS_NONE &&
+      (all_solutions || count_only || options.threads > 1 || options.portfolio > 0)) {
+    error = "-restarts only finds a first solution, on one thread";
+    return false;
+  }
+  return true;
+}
+
+
+// ==========================================================================
+// With -batch or -serve in place of the puzzle file, mode is set to it and
+// filename is the manifest or the socket (see BATCH MODE and DAEMON MODE
+// below).  -cache, -cache_mb and -binary_output are for the whole
+// process, so they are taken out here rather than in ParseOptions (see
+// RESULT CACHE below, and solutionfile.h).
+void HandleCommandLineArguments(int argc, char *argv[], std::string &filename, std::string &mode,
+                                int &rows, int &columns, bool &all_solutions,
+                                bool &count_only, SolverOptions &options, RenderContext &context,
+                                std::string &cache_directory, int &cache_mb,
+                                std::string &binary_output) {
 
   // must at least put the filename on the command line
   if (argc < 2) {
     usage(argc,argv);
   }
   filename = argv[1];
+  int first = 2;
+  if (filename == "-batch" || filename == "-serve") {
+    if (argc < 3) {
+      usage(argc,argv);
+    }
+    mode = filename;
+    filename = argv[2];
+    first = 3;
+  }
 
   // parse the optional arguments
-  for (int i = 2; i < argc; i++) {
-    if (argv[i] == std::string("-tile_size")) {
-      i++;
-      assert (i < argc);
-      GLOBAL_TILE_SIZE = atoi(argv[i]);
-      if (GLOBAL_TILE_SIZE < 11 || GLOBAL_TILE_SIZE % 2 == 0) {
-        std::cerr << "ERROR: bad tile_size" << std::endl;
+  std::vector<std::string> args;
+  for (int i = first; i < argc; i++) {
+    if (argv[i] == std::string("-cache") || argv[i] == std::string("-cache_mb") ||
+        argv[i] == std::string("-binary_output")) {
+      if (i+1 >= argc) {
+        std::cerr << "ERROR: missing value for " << argv[i] << std::endl;
         usage(argc,argv);
       }
-    } else if (argv[i] == std::string("-all_solutions")) {
-      all_solutions = true;
-    } else if (argv[i] == std::string("-board_dimensions")) {
-      i++;
-      assert (i < argc);
-      rows = atoi(argv[i]);
-      i++;
-      assert (i < argc);
-      columns = atoi(argv[i]);
-      if (rows < 1 || columns < 1) {
+      if (argv[i] == std::string("-cache")) {
+        cache_directory = argv[++i];
+      } else if (argv[i] == std::string("-binary_output")) {
+        binary_output = argv[++i];
+      } else if ((cache_mb = atoi(argv[++i])) < 1) {
+        std::cerr << "ERROR: bad cache_mb" << std::endl;
         usage(argc,argv);
       }
-    } else if (argv[i] == std::string("-allow_rotations")) {
-      allow_rotations = true;
     } else {
-      std::cerr << "ERROR: unknown argument '" << argv[i] << "'" << std::endl;
-      usage(argc,argv);
+      args.push_back(argv[i]);
     }
   }
+  std::string error;
+  if (!ParseOptions(args, rows, columns, all_solutions, count_only, options, context, error)) {
+    std::cerr << "ERROR: " << error << std::endl;
+    usage(argc,argv);
+  }
+  if (binary_output != "" && (mode != "" || !all_solutions || count_only)) {
+    std::cerr << "ERROR: -binary_output is for -all_solutions of a single puzzle" << std::endl;
+    usage(argc,argv);
+  }
 }
 
 
 // ==========================================================================
+// reads the tiles of the puzzle file (see puzzlefile.h)
 void ParseInputFile(int argc, char *argv[], const std::string &filename, std::vector<Tile*> &tiles) {
-
-  // open the file
-  std::ifstream istr(filename.c_str());
-  if (!istr) {
-    std::cerr << "ERROR: cannot open file '" << filename << "'" << std::endl;
+  std::string error;
+  if (!ReadPuzzleFile(filename, tiles, error)) {
+    std::cerr << "ERROR: " << error << std::endl;
     usage(argc,argv);
   }
-  assert (istr);
+}
 
-  // read each line of the file
-  std::string token, north, east, south, west;
-  while (istr >> token >> north >> east >> south >> west) {
-    assert (token == "tile");
-    Tile *t = new Tile(north,east,south,west);
-    tiles.push_back(t);
-  }
+
+// ==========================================================================
+// RESULT CACHE
+// With -cache <directory> every answer is kept on disk (see ResultCache),
+// and a puzzle asked again, with its tiles in any order, is answered from
+// there without a search.  One directory may serve the jobs of a batch,
+// the requests to a daemon and any number of runs, and holds at most
+// -cache_mb megabytes.  A first solution from the cache need not be the
+// one a search would find first today, but it is a solution all the same.
+
+// what a puzzle asks of the cache
+int CacheMode(bool all_solutions, bool count_only) {
+  if (count_only) return ResultCache::COUNT;
+  if (all_solutions) return ResultCache::ALL;
+  return ResultCache::FIRST;
 }
 
-//============================================================================
-bool NotInVector(const std::vector<Location>& Nearby, int r, int c){
-  for(int i=0; i<Nearby.size(); i++){
-    if (r==Nearby[i].row && c==Nearby[i].column)
-      return false;
-  }
-  return true;
+// Answers the puzzle from the cache if it is there, and otherwise with a
+// search whose answer is kept, unless it was cut short.  Each solution
+// goes to the callback; returns the count, which is 0 or 1 for a first
+// solution.  With no cache this is just the solver.  Solutions too many
+// to fit in the cache are not held on to; only their count is kept.
+unsigned long long SolveCached(Solver &solver, int mode, ResultCache *cache,
+                               const SolutionCallback &callback) {
+  const TileSet &set = solver.tileSet();
+  int tiles = set.numTiles();
+  int rows = solver.board().numRows();
+  int columns = solver.board().numColumns();
+  bool rotations = solver.options().allow_rotations;
+  if (tiles == 0) {
+    cache = NULL;
+  }
+  CachedResult result;
+  if (cache != NULL && cache->lookup(set, rows, columns, rotations, mode, result)) {
+    for (size_t s = 0; s < result.solutions.size(); s += tiles) {
+      callback(std::vector<Location>(result.solutions.begin()+s, result.solutions.begin()+s+tiles));
+    }
+    return result.count;
+  }
+  if (mode == ResultCache::COUNT) {
+    result.count = solver.count();
+  } else if (mode == ResultCache::ALL) {
+    // the solutions are only held on to while they could still fit in
+    // the cache; past that the count is all that is kept
+    bool keep = cache != NULL;
+    result.count = solver.forEachSolution([&callback, &result, &keep, cache](const std::vector<Location>& locations) {
+      if (keep && !cache->canKeep(result.solutions.size() + locations.size())) {
+        keep = false;
+        std::vector<Location>().swap(result.solutions);
+      }
+      if (keep)
+        result.solutions.insert(result.solutions.end(), locations.begin(), locations.end());
+      callback(locations);
+    });
+    if (!keep) {
+      mode = ResultCache::COUNT;
+    }
+  } else if (solver.solveFirst()) {
+    result.count = 1;
+    result.solutions = solver.solution();
+    callback(result.solutions);
+  }
+  // a solution found just before a cancel still counts
+  if (cache != NULL && (!solver.cancelled() || (mode == ResultCache::FIRST && result.count > 0))) {
+    cache->store(set, rows, columns, rotations, mode, result);
+  }
+  return result.count;
 }
 
-//===========================================================================
-void FindNearby(Board& board, std::vector<Location>& Nearby, const std::vector<Location>& locations){
-  
-  bool Empty=true;
-  Nearby.clear();
-  for (int i=0; i<board.numRows(); i++){
-    for (int j=0; j<board.numColumns(); j++){
-      if(board.getTile(i, j)!=NULL){
-        Empty=false;
-        //std::cout << "FindNearby" <<std::endl;
-        if (i+1>=0 && i+1 <board.numRows()){
-          if(NotInVector(Nearby, i+1, j) && NotInVector(locations, i+1, j) )
-            Nearby.push_back(Location(i+1,j,0));
-        }
-        if (i-1>=0 && i-1 <board.numRows()){
-          if(NotInVector(Nearby, i-1, j) && NotInVector(locations, i-1, j) )
-            Nearby.push_back(Location(i-1,j,0));
-        }
-        if (j+1>=0 && j+1 <board.numColumns()){
-          if(NotInVector(Nearby, i, j+1) && NotInVector(locations, i, j+1) )
-            Nearby.push_back(Location(i,j+1,0));
-        }
-        if (j-1>=0 && j-1 <board.numColumns()){
-          if(NotInVector(Nearby, i, j-1) && NotInVector(locations, i, j-1) )
-            Nearby.push_back(Location(i,j-1,0));
-        }
-        
+// ==========================================================================
+// BATCH MODE
+// With -batch the puzzle file is replaced by a manifest listing many
+// puzzles, which are solved in one process by a fixed pool of threads.
+// Each line of the manifest is one job: a puzzle file, the board height
+// and width, and any options for that puzzle alone.  Blank lines and
+// lines starting with # are skipped.  Options on the command line apply
+// to every job, except -threads, which is the size of the pool; each job
+// runs on one thread, and -time_limit caps each job on its own.
+//
+// Every job writes its result as soon as it is done, so jobs appear in
+// the order they finish, and the lines of one job are never split up:
+//   <line> <file> <seconds> solved <locations>
+//   <line> <file> <seconds> unsolvable
+//   <line> <file> <seconds> count <n>
+//   <line> <file> <seconds> solutions <n>, then n lines of
+//   <line> <file> solution <locations>
+//   <line> <file> <seconds> timeout
+//   <line> <file> <seconds> error <reason>
+// where <line> is the job's line number in the manifest.
+
+// Tiny all-public class for one puzzle to solve and how, from a line of
+// the manifest (or a daemon request, see DAEMON MODE).
+class PuzzleJob {
+public:
+  PuzzleJob() : line(0), rows(-1), columns(-1), all_solutions(false), count_only(false) {}
+  int line;
+  std::string filename;
+  int rows;
+  int columns;
+  bool all_solutions;
+  bool count_only;
+  SolverOptions options;
+};
+
+// Jobs whose tiles have the same edges in the same order share one
+// TileSet, so its edge tables are built only once per batch.  The table
+// owns the sets and the tiles they were built from.
+class TileSetTable {
+public:
+  ~TileSetTable() {
+    for (std::map<std::vector<int>, TileSet*>::iterator itr = sets.begin(); itr != sets.end(); itr++) {
+      delete itr->second;
+    }
+    for (int t = 0; t < owned.size(); t++) {
+      delete owned[t];
+    }
+  }
+  // the set for these tiles, which the table takes over
+  const TileSet& get(std::vector<Tile*> &tiles) {
+    std::vector<int> key(tiles.size());
+    for (int t = 0; t < tiles.size(); t++) {
+      key[t] = tiles[t]->signature();
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<std::vector<int>, TileSet*>::iterator itr = sets.find(key);
+    if (itr == sets.end()) {
+      itr = sets.insert(std::make_pair(key, new TileSet(tiles))).first;
+      owned.insert(owned.end(), tiles.begin(), tiles.end());
+    } else {
+      for (int t = 0; t < tiles.size(); t++) {
+        delete tiles[t];
       }
     }
+    tiles.clear();
+    return *itr->second;
   }
-  if (Empty==true){
-    Nearby.push_back(Location(4, 4, 0));
-  }
-}
-//===========================================================================
-bool NotLoose(Board& board, std::vector<Location>& locations){
-  //std::cout<< "here5 " << std::endl;
-  for (int i; i<locations.size(); i++){
-          //std::cout<< "here5 " << std::endl;
-    Tile temp=board[locations[i].row][locations[i].column]->rotate(board[locations[i].row][locations[i].column]->getRotation());
-    if (temp.getNorth()!="pasture"){
-      if(locations[i].row-1<0)
-        return false;
-      else if(board[locations[i].row-1][locations[i].column]==NULL)
-        return false;
-    }
-    if (temp.getSouth()!="pasture"){
+private:
+  std::mutex lock;
+  std::map<std::vector<int>, TileSet*> sets;
+  std::vector<Tile*> owned;
+};
 
-      if(locations[i].row+1>board.numRows())
-        return false;
-      else if(board[locations[i].row+1][locations[i].column]==NULL)
-        return false;
-    }
-    if(temp.getWest()!="pasture"){
-      if(locations[i].column-1<0)
-        return false;
-      else if(board[locations[i].row][locations[i].column-1]==NULL)
-        return false;
-    }
-    if(temp.getEast()!="pasture"){
-      if(locations[i].column+1>board.numColumns())
-        return false;
-      else if(board[locations[i].row][locations[i].column+1]==NULL)
-        return false;
-    }
+// Reads the manifest; the defaults hold the options from the command
+// line.  Any line that makes no sense stops the program before a single
+// job has run.
+void ReadManifest(int argc, char *argv[], const std::string &filename, const PuzzleJob &defaults,
+                  std::vector<PuzzleJob> &jobs) {
+  std::ifstream istr(filename.c_str());
+  if (!istr) {
+    std::cerr << "ERROR: cannot open manifest '" << filename << "'" << std::endl;
+    usage(argc,argv);
   }
-  std::cout<< "here5 " << std::endl;
-  return true;
-}
-//============================================================================
-bool match(Board& board, int r, int c, std::vector<Tile*>& tiles, std::vector<Location>& locations){
-  std::cout << "test match of " << locations.size()-1 << " tile in location ("<< r <<","<< c <<"). rotation "<<locations.back().rotation << std::endl;
-  //Location MatchPiece(r, c, 0);
-  bool north=true;
-  bool south=true;
-  bool west=true;
-  bool east=true;
-  int level=0;
-  int n=locations.size()-1;
-  Tile temp=tiles[n]->rotate(locations.back().rotation);
-  std::cout << temp.getNorth() << " " << temp.getEast() <<" "<< temp.getSouth() << " "<< temp.getWest()<< std::endl;
-  if (r==0 || r==board.numRows()-1 || c==0 || c==board.numColumns()-1 ){
-    if (r==0 && c==0 ){
-      if (board.getTile(r+1, c)!=NULL){
-        if (temp.getSouth() != board.getTile(r+1, c)->rotate(board.getTile(r+1, c)->getRotation()).getNorth())
-          south=false;
-        else if (temp.getSouth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c+1)!=NULL){
-        if (temp.getEast() != board.getTile(r, c+1)->rotate(board.getTile(r, c+1)->getRotation()).getWest())
-          east=false;
-        else if (temp.getEast()!="pasture")
-          level++;
+  std::string text;
+  for (int line = 1; std::getline(istr, text); line++) {
+    std::istringstream words(text);
+    std::vector<std::string> args;
+    std::string word;
+    while (words >> word) {
+      args.push_back(word);
+    }
+    if (args.empty() || args[0][0] == '#') {
+      continue;
+    }
+    PuzzleJob job = defaults;
+    job.line = line;
+    job.filename = args[0];
+    std::string error;
+    if (args.size() < 3) {
+      error = "expected <file> <rows> <columns> [options]";
+    } else {
+      // the dimensions are checked like -board_dimensions
+      args[0] = "-board_dimensions";
+      RenderContext context;
+      if (ParseOptions(args, job.rows, job.columns, job.all_solutions, job.count_only,
+                       job.options, context, error) &&
+          (job.options.threads != 1 || job.options.portfolio > 0)) {
+        error = "a job runs on one thread, so it cannot have -threads or -portfolio";
       }
     }
-    if (r==0 && c==board.numColumns()-1 ){
-      if (board.getTile(r+1, c)!=NULL){
-        if (temp.getSouth() != board.getTile(r+1, c)->rotate(board.getTile(r+1, c)->getRotation()).getNorth())
-          south=false;
-        else if (temp.getSouth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c-1)!=NULL){
-        if (temp.getWest() != board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getEast())
-          west=false;
-        else if (temp.getWest()!="pasture")
-          level++;
-      }
+    if (error != "") {
+      std::cerr << "ERROR: " << filename << " line " << line << ": " << error << std::endl;
+      usage(argc,argv);
     }
+    jobs.push_back(job);
+  }
+}
 
-    if (r==board.numRows()-1 && c==board.numColumns()-1 ){
-      if (board.getTile(r-1, c)!=NULL){
-        if (temp.getNorth() != board.getTile(r-1, c)->rotate(board.getTile(r-1, c)->getRotation()).getSouth())
-          north=false;
-        else if (temp.getNorth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c-1)!=NULL){
-        if (temp.getWest() != board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getEast())
-          west=false;
-        else if (temp.getWest()!="pasture")
-          level++;
-      }
-    }
-    if (r==board.numRows()-1 && c==0){
-      if (board.getTile(r-1, c)!=NULL){
-        if (temp.getNorth() != board.getTile(r-1, c)->rotate(board.getTile(r-1, c)->getRotation()).getSouth())
-          north=false;
-        else if (temp.getNorth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c+1)!=NULL){
-        if (temp.getEast() != board.getTile(r, c+1)->rotate(board.getTile(r, c+1)->getRotation()).getWest())
-          east=false;
-        else if (temp.getEast()!="pasture")
-          level++;
-      }
-    }
-    if (r==0 && c!=0 && c!=board.numColumns()-1 ){
-      if (board.getTile(r+1, c)!=NULL){
-        if (temp.getSouth() != board.getTile(r+1, c)->rotate(board.getTile(r+1, c)->getRotation()).getNorth())
-          south=false;
-        else if (temp.getSouth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c+1)!=NULL){
-        if (temp.getEast() != board.getTile(r, c+1)->rotate(board.getTile(r, c+1)->getRotation()).getWest())
-          east=false;
-        else if (temp.getEast()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c-1)!=NULL){
-        if (temp.getWest() != board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getEast())
-          west=false;
-        else if (temp.getWest()!="pasture")
-          level++;
-      }
-    }
-    if (r!=0 && r!=board.numRows()-1 && c==board.numColumns()-1 ){
-      //std::cout << "heer"<< std::endl;
-      if (board.getTile(r-1, c)!=NULL){
-        if (temp.getNorth() != board.getTile(r-1, c)->rotate(board.getTile(r-1, c)->getRotation()).getSouth())
-          north=false;
-        else if (temp.getNorth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r+1, c)!=NULL){
-        if (temp.getSouth() != board.getTile(r+1, c)->rotate(board.getTile(r+1, c)->getRotation()).getNorth())
-          south=false;
-        else if (temp.getSouth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c-1)!=NULL){
-        if (temp.getWest() != board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getEast()){
-          //std::cout<< "here"<< r << c-1<< temp.getWest()<<board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getEast()<< board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getWest()
-         //<<board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getNorth()<<board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getSouth()<<std::endl;
-          west=false;
-        }
-        else if (temp.getWest()!="pasture")
-          level++;
-      }
-      //std::cout << North << west << std::endl;
-    }
-    if (r==board.numRows()-1 && c!=0 && c!=board.numColumns()-1 ){
-      //std::cout << "here" << std::endl;
-      if (board.getTile(r-1, c)!=NULL){
-        if (temp.getNorth() != board.getTile(r-1, c)->rotate(board.getTile(r-1, c)->getRotation()).getSouth())
-          north=false;
-        else if (temp.getNorth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c+1)!=NULL){
-        if (temp.getEast() != board.getTile(r, c+1)->rotate(board.getTile(r, c+1)->getRotation()).getWest())
-          east=false;
-        else if (temp.getEast()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c-1)!=NULL){
-        if (temp.getWest() != board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getEast())
-          west=false;
-        else if (temp.getWest()!="pasture")
-          level++;
-      }
-      //std::cout << "here" << std::endl;
-    }
-    if (r!=0 && r!=board.numRows()-1 && c==0){
-      if (board.getTile(r-1, c)!=NULL){
-        if (temp.getNorth() != board.getTile(r-1, c)->rotate(board.getTile(r-1, c)->getRotation()).getSouth())
-          north=false;
-        else if (temp.getNorth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r+1, c)!=NULL){
-        if (temp.getSouth() != board.getTile(r+1, c)->rotate(board.getTile(r+1, c)->getRotation()).getNorth())
-          south=false;
-        else if (temp.getSouth()!="pasture")
-          level++;
-      }
-      if (board.getTile(r, c+1)!=NULL){
-        if (temp.getEast() != board.getTile(r, c+1)->rotate(board.getTile(r, c+1)->getRotation()).getWest())
-          east=false;
-        else if (temp.getEast()!="pasture")
-          level++;
-      }
-    }
+// writes one location per tile after the prefix, as one line
+void WriteLocations(std::ostream &ostr, const std::string &prefix, const std::vector<Location> &locations) {
+  ostr << prefix;
+  for (int i = 0; i < locations.size(); i++) {
+    ostr << locations[i];
   }
-  //std::cout << "test match2" <<std::endl;
-  else {
-  if (board.getTile(r-1, c)!=NULL){
-    if (temp.getNorth() != board.getTile(r-1, c)->rotate(board.getTile(r-1, c)->getRotation()).getSouth())
-      north=false;
-    else if (temp.getNorth()!="pasture")
-      level++;
+  ostr << '\n';
+}
+
+// Solves one job and writes its lines to the shared output in one piece.
+void RunBatchJob(const PuzzleJob &job, TileSetTable &table, ResultCache *cache, std::mutex &output) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::ostringstream result;
+  std::ostringstream solutions;
+  std::vector<Tile*> tiles;
+  std::string error;
+  if (!ReadPuzzleFile(job.filename, tiles, error)) {
+    result << "error " << error;
+  } else if ((long long)job.rows * job.columns < (long long)tiles.size()) {
+    result << "error board is not large enough";
+    for (int t = 0; t < tiles.size(); t++) {
+      delete tiles[t];
+    }
+  } else {
+    Solver solver(table.get(tiles), job.rows, job.columns, job.options);
+    int mode = CacheMode(job.all_solutions, job.count_only);
+    std::ostringstream prefix;
+    prefix << job.line << ' ' << job.filename << " solution ";
+    std::string p = prefix.str();
+    // all the solutions are formatted on a thread of their own
+    SolutionPipe *pipe = NULL;
+    if (mode == ResultCache::ALL) {
+      pipe = new SolutionPipe(solver.tileSet().numTiles(), [&solutions, &p](const std::vector<Location>& locations) {
+        WriteLocations(solutions, p, locations);
+      });
+    }
+    std::vector<Location> first;
+    unsigned long long count = SolveCached(solver, mode, cache, [pipe, &first](const std::vector<Location>& locations) {
+      if (pipe != NULL)
+        pipe->push(locations);
+      else
+        first = locations;
+    });
+    delete pipe;
+    if (solver.cancelled() && !(mode == ResultCache::FIRST && count > 0)) {
+      result << "timeout";
+      solutions.str("");
+    } else if (mode == ResultCache::COUNT) {
+      result << "count " << count;
+    } else if (mode == ResultCache::ALL) {
+      result << "solutions " << count;
+    } else if (count > 0) {
+      WriteLocations(result, "solved ", first);
+    } else {
+      result << "unsolvable";
+    }
   }
-  if (board.getTile(r+1, c)!=NULL){
-    if (temp.getSouth() != board.getTile(r+1, c)->rotate(board.getTile(r+1, c)->getRotation()).getNorth())
-      south=false;
-    else if (temp.getSouth()!="pasture")
-      level++;
+  std::string text = result.str();
+  if (text.empty() || text[text.size()-1] != '\n') {
+    text += '\n';
   }
-  if (board.getTile(r, c+1)!=NULL){
-    if (temp.getEast() != board.getTile(r, c+1)->rotate(board.getTile(r, c+1)->getRotation()).getWest())
-      east=false;
-    else if (temp.getEast()!="pasture")
-      level++;
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::lock_guard<std::mutex> guard(output);
+  std::cout << job.line << ' ' << job.filename << ' '
+            << std::fixed << std::setprecision(3) << seconds << ' ' << text << solutions.str();
+  std::cout.flush();
+}
+
+// one thread of the pool, taking jobs until there are none left
+void BatchWorker(const std::vector<PuzzleJob> *jobs, std::atomic<int> *next,
+                 TileSetTable *table, ResultCache *cache, std::mutex *output) {
+  for (;;) {
+    int i = (*next)++;
+    if (i >= jobs->size())
+      return;
+    RunBatchJob((*jobs)[i], *table, cache, *output);
   }
-  if (board.getTile(r, c-1)!=NULL){
-    if (temp.getWest() != board.getTile(r, c-1)->rotate(board.getTile(r, c-1)->getRotation()).getEast())
-      west=false;
-    else if (temp.getWest()!="pasture")
-      level++;
+}
+
+// runs the jobs on a pool of threads; the calling thread is one of them
+void RunBatch(const std::vector<PuzzleJob> &jobs, int threads, ResultCache *cache) {
+  TileSetTable table;
+  std::mutex output;
+  std::atomic<int> next(0);
+  std::vector<std::thread> pool;
+  for (int w = 1; w < threads; w++) {
+    pool.push_back(std::thread(BatchWorker, &jobs, &next, &table, cache, &output));
   }
+  BatchWorker(&jobs, &next, &table, cache, &output);
+  for (int w = 0; w < pool.size(); w++) {
+    pool[w].join();
   }
-  //std::cout << "heer"<< std::endl;
-  /*
-  if ((temp.getNorth() != board.getTile(r-1, c)->rotate(board.getTile(r-1, c)->getRotation()).getNorth()||board.getTile(r-1, c)==NULL) 
-      && (temp.getSouth() == board.getTile(r+1,c)->getSouth()||board.getTile(r+1, c)==NULL)
-      && (temp.getEast() == board.getTile(r,c+1)->getEast()||board.getTile(r, c+1)==NULL)
-      && (temp.getWest() == board.getTile(r,c-1)->getWest()||board.getTile(r, c-1)==NULL)){
-    std::cout << "did not find a solution" <<std::endl;
-    return true;
+}
+
+
+// ==========================================================================
+// DAEMON MODE
+// With -serve the puzzle file is replaced by the path of a Unix-domain
+// socket, and the program stays up answering requests from any number
+// of clients (see client.cpp) on a fixed pool of threads.  As in batch
+// mode, options on the command line apply to every request, -threads is
+// the size of the pool, and each request runs on one thread.
+//
+// Messages go both ways as frames (see FramedSocket).  A client sends
+//   solve <id> <options>, then the lines of a puzzle file
+//   cancel <id>
+// where the options are those of the command line, -board_dimensions
+// included, and -time_limit is the deadline.  For each solve it gets
+// back a message per solution as soon as it is found
+//   solution <id> <locations>
+// and then exactly one of
+//   done <id> solved | unsolvable | count <n> | solutions <n>
+//   done <id> timeout | cancelled | error <reason>
+// A client that goes away cancels whatever it still has running.  So
+// does one that stops reading: a message the client has not taken in
+// SEND_TIMEOUT seconds, or a solution it has not taken by the time limit
+// of its request, drops the connection (see FramedSocket::send).
+
+// seconds a client may leave a message untaken
+static const double SEND_TIMEOUT = 10;
+
+class DaemonJob;
+
+// Tiny all-public class for one client.  The lock guards the requests
+// that have not been answered yet, by id.
+class DaemonConnection {
+public:
+  DaemonConnection(int fd) : socket(fd) {}
+  FramedSocket socket;
+  std::mutex lock;
+  std::map<std::string, DaemonJob*> jobs;
+};
+
+// Tiny all-public class for one solve request.  The connection's lock
+// guards solver, pipe and cancelled.
+class DaemonJob {
+public:
+  DaemonJob() : solver(NULL), pipe(NULL), cancelled(false) {}
+  std::shared_ptr<DaemonConnection> connection;
+  std::string id;
+  PuzzleJob request;
+  std::vector<Tile*> tiles;
+  Solver *solver;      // while the request runs
+  SolutionPipe *pipe;  // while the request runs, if it streams solutions
+  bool cancelled;
+};
+
+// Tiny all-public class with the requests waiting for a thread.
+class DaemonQueue {
+public:
+  std::mutex lock;
+  std::condition_variable ready;
+  std::deque<DaemonJob*> jobs;
+};
+
+// With the connection's lock held.  The pipe is aborted too, or a search
+// waiting for room in it would never see the cancel.
+void CancelJob(DaemonJob *job) {
+  job->cancelled = true;
+  if (job->solver != NULL) {
+    job->solver->cancel();
+  }
+  if (job->pipe != NULL) {
+    job->pipe->abort();
   }
-  */
-  if(north ==false || south==false || east==false || west==false){
-    std::cout << north << " " <<south << " "<< east << " " << west<< "not matching"<<std::endl;
-    return false;
+}
+
+// Checks a solve request and queues it, or returns why it cannot run.
+std::string QueueRequest(const std::shared_ptr<DaemonConnection> &connection, const std::string &id,
+                         const std::vector<std::string> &args, const std::string &puzzle,
+                         const PuzzleJob &defaults, DaemonQueue &queue) {
+  DaemonJob *job = new DaemonJob;
+  job->connection = connection;
+  job->id = id;
+  job->request = defaults;
+  PuzzleJob &r = job->request;
+  RenderContext context;
+  std::string error;
+  if (!ParseOptions(args, r.rows, r.columns, r.all_solutions, r.count_only, r.options, context, error)) {
+  } else if (r.options.threads != 1 || r.options.portfolio > 0) {
+    error = "a request runs on one thread, so it cannot have -threads or -portfolio";
+  } else if (r.rows < 1) {
+    error = "missing -board_dimensions";
+  } else if (!ParsePuzzle(puzzle, job->tiles, error)) {
+  } else if ((long long)r.rows * r.columns < (long long)job->tiles.size()) {
+    error = "board is not large enough";
+  } else {
+    std::lock_guard<std::mutex> guard(connection->lock);
+    if (connection->jobs.count(id)) {
+      error = "id " + id + " is already running";
+    } else {
+      connection->jobs[id] = job;
+    }
   }
-  int NumNULL=0;
-  int NumTiles=4;
-  if (r+1 <board.numRows()){
-    if (board.getTile(r+1,c)==NULL)
-      NumNULL++;
-  }
-  else
-    NumTiles--;
-  if (r-1>=0){
-    if (board.getTile(r-1,c)==NULL)
-      NumNULL++;
-  }
-  else
-    NumTiles--;
-  if (c+1 < board.numColumns()){
-    if (board.getTile(r,c+1)==NULL)
-      NumNULL++;
-  }
-  else
-    NumTiles--;
-  if (c-1 >= 0) {
-    if( board.getTile(r,c-1)==NULL)
-      NumNULL++;
-  }
-  else
-    NumTiles--;
-  //std::cout << "level: "<<level<<"NumTiles: "<<NumTiles<<"NumNULL: "<<NumNULL <<std::endl;
-  if (level == NumTiles-NumNULL){
-    //std::cout<< "size of location " << locations.size()<<std::endl;
-    if (locations.size()==tiles.size()){
-      board.setTile(r,c,tiles[n]);
-      if ( NotLoose(board, locations) ){
-        //std::cout<< "size of location" << locations.size()<<std::endl;
-        board.setTile(r,c,NULL);
-        return true;
-      }
-      else
-        board.setTile(r,c,NULL);
-        return false;
+  if (error != "") {
+    for (int t = 0; t < job->tiles.size(); t++) {
+      delete job->tiles[t];
     }
-    else
-      return true;
+    delete job;
+    return error;
   }
-  else
-    return false;
+  std::lock_guard<std::mutex> guard(queue.lock);
+  queue.jobs.push_back(job);
+  queue.ready.notify_one();
+  return "";
 }
 
-//===========================================================================
-bool FindSolution(Board& board, std::vector<Tile*>& tiles, std::vector<Location>& locations){
-  if (locations.size()==tiles.size()){
-    //std::cout << "tested1" << std::endl;
-    return true;
-  }
-  std::vector<Location> Nearby;
-  FindNearby(board, Nearby, locations);
-  for(int j=0; j<Nearby.size(); j++){//output the nearby positions.
-    std::cout << "( "<<Nearby[j].row<<" , "<<Nearby[j].column<<" )"<<std::endl;
-  }
-  for(int i=0; i<Nearby.size(); i++){
-    std::cout << "finding a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()<<" tile."<<std::endl;
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 0));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile."<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if(FindSolution(board, tiles, locations))
-        return true;
-      else{
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-        locations.pop_back();
+// Reads the requests of one client until it goes away.
+void ServeConnection(std::shared_ptr<DaemonConnection> connection, const PuzzleJob *defaults,
+                     DaemonQueue *queue) {
+  std::string message;
+  while (connection->socket.receive(message)) {
+    // the first line is the request, the rest is the puzzle
+    size_t newline = message.find('\n');
+    std::string first = message.substr(0, newline);
+    std::string puzzle = newline == std::string::npos ? "" : message.substr(newline+1);
+    std::istringstream words(first);
+    std::string verb, id, word;
+    words >> verb >> id;
+    std::vector<std::string> args;
+    while (words >> word) {
+      args.push_back(word);
+    }
+    if (verb == "solve" && id != "") {
+      std::string error = QueueRequest(connection, id, args, puzzle, *defaults, *queue);
+      if (error != "") {
+        connection->socket.send("done " + id + " error " + error, SEND_TIMEOUT);
+      }
+    } else if (verb == "cancel" && id != "") {
+      std::lock_guard<std::mutex> guard(connection->lock);
+      std::map<std::string, DaemonJob*>::iterator itr = connection->jobs.find(id);
+      if (itr != connection->jobs.end()) {
+        CancelJob(itr->second);
       }
+    } else {
+      connection->socket.send("error bad request '" + first + "'", SEND_TIMEOUT);
     }
-    else
-      locations.pop_back();
   }
-  return false;
+  std::lock_guard<std::mutex> guard(connection->lock);
+  for (std::map<std::string, DaemonJob*>::iterator itr = connection->jobs.begin();
+       itr != connection->jobs.end(); itr++) {
+    CancelJob(itr->second);
+  }
 }
-//==============================================================================
-bool FindSolutionR(Board& board, std::vector<Tile*>& tiles, std::vector<Location>& locations){
-  if (locations.size()==tiles.size()){
-    //std::cout << "tested1" << std::endl;
-    return true;
-  }
-  std::vector<Location> Nearby;
-  FindNearby(board, Nearby, locations);
-  for(int j=0; j<Nearby.size(); j++){//output the nearby positions.
-    std::cout << "( "<<Nearby[j].row<<" , "<<Nearby[j].column<<" )"<<std::endl;
-  }
-  for(int i=0; i<Nearby.size(); i++){
-    //std::cout << "finding a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()<<" tile."<<std::endl;
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 0));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      //std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile."<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if(FindSolutionR(board, tiles, locations))
-        return true;
-      else{
-        tiles[locations.size()-1]->rotate(0);
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-        locations.pop_back();
-      }
-    }
-    else{
-      tiles[locations.size()-1]->rotate(0);
-      locations.pop_back();
-    }
-
-    //rotate by 90
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 90));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      //std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile. rotation 90"<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if(FindSolutionR(board, tiles, locations))
-        return true;
-      else{
-        tiles[locations.size()-1]->rotate(0);
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-        locations.pop_back();
-      }
-    }
-    else{
-      tiles[locations.size()-1]->rotate(0);
-      locations.pop_back();
-    }
-
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 180));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      //std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile.rotation 180"<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if(FindSolutionR(board, tiles, locations))
-        return true;
-      else{
-        tiles[locations.size()-1]->rotate(0);
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-        locations.pop_back();
-      }
-    }
-    else{
-      tiles[locations.size()-1]->rotate(0);
-      locations.pop_back();
-    }
-
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 270));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      //std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile. rotation 270"<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if(FindSolutionR(board, tiles, locations))
-        return true;
-      else{
-        tiles[locations.size()-1]->rotate(0);
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-        locations.pop_back();
-      }
-    }
-    else{
-      tiles[locations.size()-1]->rotate(0);
-      locations.pop_back();
-    }
+
+// the message for one solution
+std::string SolutionMessage(const std::string &id, const std::vector<Location> &locations) {
+  std::ostringstream message;
+  message << "solution " << id << ' ';
+  for (int i = 0; i < locations.size(); i++) {
+    message << locations[i];
   }
-  return false;
+  return message.str();
 }
-//==========================================================================
-void FindAllSolutionsR(Board& board, std::vector<Tile*>& tiles, std::vector<Location>& locations, std::vector<std::vector<Location> >& solutions){
-
-  std::vector<Location> Nearby;
-  FindNearby(board, Nearby, locations);
-  for(int j=0; j<Nearby.size(); j++){//output the nearby positions.
-    std::cout << "( "<<Nearby[j].row<<" , "<<Nearby[j].column<<" )"<<std::endl;
-  }
-  for(int i=0; i<Nearby.size(); i++){
-    std::cout << "finding a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()<<" tile."<<std::endl;
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 0));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile."<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if (!FindSolutionR(board, tiles, locations)){
-        locations.pop_back();
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-      }
-      else{
-      if(locations.size()==tiles.size()){
-        solutions.push_back(locations);
-        locations.pop_back();
-      }
-      else{
-        FindAllSolutionsR(board, tiles, locations, solutions);
-      }
-    }
-    }
-    else
-      locations.pop_back();
-
-    //rotation by 90
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 90));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile."<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if (!FindSolutionR(board, tiles, locations)){
-        locations.pop_back();
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-      }
-      else{
-      if(locations.size()==tiles.size()){
-        solutions.push_back(locations);
-        locations.pop_back();
-      }
-      else{
-        FindAllSolutionsR(board, tiles, locations, solutions);
-      }
-    }
-    }
-    else
-      locations.pop_back();
-
-    //rotation by 180
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 180));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile."<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if (!FindSolutionR(board, tiles, locations)){
-        locations.pop_back();
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-      }
-      else{
-      if(locations.size()==tiles.size()){
-        solutions.push_back(locations);
-        locations.pop_back();
-      }
-      else{
-        FindAllSolutionsR(board, tiles, locations, solutions);
-      }
-    }
-    }
+
+// Runs one request, streaming its solutions back, and answers it.
+void RunDaemonJob(DaemonJob *job, ResultCache *cache) {
+  DaemonConnection &connection = *job->connection;
+  const PuzzleJob &r = job->request;
+  Solver solver(job->tiles, r.rows, r.columns, r.options);
+  // All the solutions are sent from a thread of their own, so a slow
+  // client holds up the search only once the pipe is full.  A send that
+  // fails, or that the client has not taken by the deadline, cancels the
+  // search and drops the rest.
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(r.options.time_limit));
+  int mode = CacheMode(r.all_solutions, r.count_only);
+  SolutionPipe *pipe = NULL;
+  SolutionCallback send = [&connection, &solver, &pipe, &r, deadline, job](const std::vector<Location>& locations) {
+    double timeout = SEND_TIMEOUT;
+    if (r.options.time_limit > 0) {
+      double left = std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count();
+      timeout = std::max(0.0, std::min(timeout, left));
+    }
+    if (!connection.socket.send(SolutionMessage(job->id, locations), timeout)) {
+      solver.cancel();
+      if (pipe != NULL)
+        pipe->abort();
+    }
+  };
+  if (mode == ResultCache::ALL) {
+    pipe = new SolutionPipe(solver.tileSet().numTiles(), send);
+  }
+  {
+    std::lock_guard<std::mutex> guard(connection.lock);
+    job->solver = &solver;
+    job->pipe = pipe;
+    if (job->cancelled) {
+      CancelJob(job);
+    }
+  }
+  unsigned long long count = SolveCached(solver, mode, cache, [pipe, &send](const std::vector<Location>& locations) {
+    if (pipe != NULL)
+      pipe->push(locations);
     else
-      locations.pop_back();
-
-    //rotation by 270
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 270));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile."<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if (!FindSolutionR(board, tiles, locations)){
-        locations.pop_back();
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-      }
-      else{
-      if(locations.size()==tiles.size()){
-        solutions.push_back(locations);
-        locations.pop_back();
-      }
-      else{
-        FindAllSolutionsR(board, tiles, locations, solutions);
+      send(locations);
+  });
+  if (pipe != NULL) {
+    pipe->close();
+  }
+  std::ostringstream done;
+  if (mode == ResultCache::COUNT) {
+    done << "count " << count;
+  } else if (mode == ResultCache::ALL) {
+    done << "solutions " << count;
+  } else if (count > 0) {
+    done << "solved";
+  } else {
+    done << "unsolvable";
+  }
+  {
+    std::lock_guard<std::mutex> guard(connection.lock);
+    job->solver = NULL;
+    job->pipe = NULL;
+    // a cancel that came once the search was over may still have cut
+    // the solutions short
+    if ((solver.cancelled() || job->cancelled) && done.str() != "solved") {
+      done.str(job->cancelled ? "cancelled" : "timeout");
+    }
+    connection.jobs.erase(job->id);
+  }
+  delete pipe;
+  connection.socket.send("done " + job->id + " " + done.str(), SEND_TIMEOUT);
+  for (int t = 0; t < job->tiles.size(); t++) {
+    delete job->tiles[t];
+  }
+  delete job;
+}
+
+// one thread of the pool, running requests for as long as the daemon is up
+void DaemonWorker(DaemonQueue *queue, ResultCache *cache) {
+  for (;;) {
+    DaemonJob *job;
+    {
+      std::unique_lock<std::mutex> guard(queue->lock);
+      while (queue->jobs.empty()) {
+        queue->ready.wait(guard);
       }
+      job = queue->jobs.front();
+      queue->jobs.pop_front();
     }
-    }
-    else
-      locations.pop_back();
-
+    RunDaemonJob(job, cache);
   }
-  //return false;
 }
-//==========================================================================
-void FindAllSolutions(Board& board, std::vector<Tile*>& tiles, std::vector<Location>& locations, std::vector<std::vector<Location> >& solutions){
-
-  std::vector<Location> Nearby;
-  FindNearby(board, Nearby, locations);
-  for(int j=0; j<Nearby.size(); j++){//output the nearby positions.
-    std::cout << "( "<<Nearby[j].row<<" , "<<Nearby[j].column<<" )"<<std::endl;
-  }
-  for(int i=0; i<Nearby.size(); i++){
-    std::cout << "finding a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()<<" tile."<<std::endl;
-    locations.push_back(Location(Nearby[i].row, Nearby[i].column, 0));
-    if (match(board, Nearby[i].row, Nearby[i].column, tiles, locations) ){
-      std::cout << "found a match at ("<<Nearby[i].row << ","<<Nearby[i].column<<"), for the "<<locations.size()-1<<" tile."<<std::endl;
-      board.setTile(Nearby[i].row, Nearby[i].column, tiles[locations.size()-1]);//the next tile
-      if (!FindSolution(board, tiles, locations)){
-        locations.pop_back();
-        board.setTile(Nearby[i].row, Nearby[i].column, NULL);
-      }
-      else{
-      if(locations.size()==tiles.size()){
-        solutions.push_back(locations);
-        locations.pop_back();
-      }
-      else{
-        FindAllSolutions(board, tiles, locations, solutions);
-      }
-    }
+
+// Listens on the socket until the process is killed; each client gets a
+// thread of its own to read its requests.  Returns only on failure.
+void RunDaemon(const std::string &path, const PuzzleJob &defaults, int threads, ResultCache *cache) {
+  int listener = FramedSocket::listenAt(path);
+  if (listener < 0) {
+    std::cerr << "ERROR: cannot listen on '" << path << "'" << std::endl;
+    return;
+  }
+  std::cerr << "listening on " << path << " with " << threads << " threads" << std::endl;
+  DaemonQueue queue;
+  for (int w = 0; w < threads; w++) {
+    std::thread(DaemonWorker, &queue, cache).detach();
+  }
+  for (;;) {
+    int fd = FramedSocket::acceptFrom(listener);
+    if (fd < 0) {
+      std::cerr << "ERROR: cannot accept on '" << path << "'" << std::endl;
+      return;
     }
-    else
-      locations.pop_back();
+    std::shared_ptr<DaemonConnection> connection(new DaemonConnection(fd));
+    std::thread(ServeConnection, connection, &defaults, &queue).detach();
   }
-  //return false;
 }
+
+
+// ==========================================================================
+// prints a solution, with the board it makes
+void PrintSolution(const TileSet &set, int rows, int columns, const std::vector<Location> &locations,
+                   const RenderContext &context) {
+  // print the solution
+  std::cout << "This is a solution: ";
+  for (int i = 0; i < locations.size(); i++) {
+    std::cout << locations[i];
+  }
+  std::cout << std::endl;
+
+  // print the ASCII art board representation
+  Board board(rows, columns, set);
+  for (int i = 0; i < locations.size(); i++) {
+    board.setTile(locations[i].row, locations[i].column, Placement(set.typeOf(i), locations[i].rotation()));
+  }
+  board.Print(context);
+  std::cout << std::endl;
+}
+
+
 // ==========================================================================
 int main(int argc, char *argv[]) {
 
   std::string filename;
+  std::string mode;
   int rows = -1;
   int columns = -1;
   bool all_solutions = false;
-  bool allow_rotations = false;
-  HandleCommandLineArguments(argc, argv, filename, rows, columns, all_solutions, allow_rotations);
+  bool count_only = false;
+  SolverOptions options;
+  RenderContext context;
+  std::string cache_directory;
+  int cache_mb = 256;
+  std::string binary_output;
+  HandleCommandLineArguments(argc, argv, filename, mode, rows, columns, all_solutions, count_only,
+                             options, context, cache_directory, cache_mb, binary_output);
+  ResultCache *cache = NULL;
+  if (cache_directory != "") {
+    cache = new ResultCache(cache_directory, (unsigned long long)cache_mb << 20);
+  }
+
+  if (mode != "") {
+    // the command line options are the defaults for every puzzle
+    PuzzleJob defaults;
+    defaults.all_solutions = all_solutions;
+    defaults.count_only = count_only;
+    defaults.options = options;
+    defaults.options.threads = 1;
+    if (mode == "-serve") {
+      RunDaemon(filename, defaults, options.threads, cache);
+      return 1;
+    }
+    std::vector<PuzzleJob> jobs;
+    ReadManifest(argc, argv, filename, defaults, jobs);
+    RunBatch(jobs, options.threads, cache);
+    delete cache;
+    return 0;
+  }
 
 
   // load in the tiles
@@ -729,103 +934,81 @@ int main(int argc, char *argv[]) {
     std::cout << std::endl;
 
     // print the ASCII art board representation
-    board.Print();
+    board.Print(context);
     std::cout << std::endl;
   }
   */
-  Board board(rows,columns);
-  std::vector<Location> locations;
-  std::vector<std::vector<Location> > solutions;
-  //std::vector<Location> Nearby;
-if (all_solutions==true && allow_rotations==true){
-  //locations.clear();
-
-  FindAllSolutionsR(board, tiles, locations, solutions);
-  if(solutions.size()==0){
-    std::cout << "did not find a solution" <<std::endl;
-  }
-  else{
-    std::cout << "found "<<solutions.size()<<" solutions."<<std::endl;
-    for (int i = 0; i < solutions.size(); i++) {
-      std::cout << "This is a solution: ";
-      for(int j=0; j< tiles.size(); j++){
-        std::cout << solutions[i][j];
-      }
-      std::cout << std::endl;
+  Solver *solver = new Solver(tiles, rows, columns, options);
+
+  if (count_only==true){
+    unsigned long long count = SolveCached(*solver, ResultCache::COUNT, cache, [](const std::vector<Location>&) {});
+    if (solver->cancelled())
+      std::cout << "stopped at the time limit" <<std::endl;
+    else if (count==0)
+      std::cout << "did not find a solution" <<std::endl;
+    else
+      std::cout << "found "<<count<<" solutions."<<std::endl;
+  }
+  else if (binary_output != ""){
+    // the solutions go to the file as they are found, written out on a
+    // thread of their own
+    SolutionWriter writer;
+    if (!writer.open(binary_output, tiles.size(), rows, columns)) {
+      std::cerr << "ERROR: cannot create file '" << binary_output << "'" << std::endl;
+      usage(argc,argv);
     }
-
-  }
-}
-
-if (all_solutions==false && allow_rotations==true){
-  if (FindSolutionR(board, tiles, locations)) {
-
-    // generate a random tile layouts
-
-    //RandomlyPlaceTiles(board, tiles, locations);
-    
-    // print the solution
-    std::cout << "This is a solution: ";
-    for (int i = 0; i < locations.size(); i++) {
-      std::cout << locations[i];
+    SolutionPipe pipe(tiles.size(), [&writer](const std::vector<Location>& locations) {
+      writer.write(locations);
+    });
+    SolveCached(*solver, ResultCache::ALL, cache, [&pipe](const std::vector<Location>& locations) {
+      pipe.push(locations);
+    });
+    pipe.close();
+    if (!writer.close()) {
+      std::cerr << "ERROR: cannot write file '" << binary_output << "'" << std::endl;
+      return 1;
+    }
+    if (solver->cancelled())
+      std::cout << "stopped at the time limit" <<std::endl;
+    std::cout << "wrote " << writer.numSolutions() << " solutions to " << binary_output << std::endl;
+  }
+  else if (all_solutions==true){
+    // the count is printed first, so the solutions wait end to end in one array
+    std::vector<Location> solutions;
+    unsigned long long count = SolveCached(*solver, ResultCache::ALL, cache, [&solutions](const std::vector<Location>& locations) {
+      solutions.insert(solutions.end(), locations.begin(), locations.end());
+    });
+    if (solver->cancelled()){
+      std::cout << "stopped at the time limit" <<std::endl;
+    }
+    else if(count==0){
+      std::cout << "did not find a solution" <<std::endl;
     }
-    std::cout << std::endl;
-
-    // print the ASCII art board representation
-    board.Print();
-    std::cout << std::endl;
-  }
-  else
-    std::cout << "did not find a solution" <<std::endl;
-
-  // delete the tiles
-
-}
-
-if (all_solutions==false && allow_rotations==false){
-  if (FindSolution(board, tiles, locations)) {
-
-    // generate a random tile layouts
-
-    //RandomlyPlaceTiles(board, tiles, locations);
-    
-    // print the solution
-    std::cout << "This is a solution: ";
-    for (int i = 0; i < locations.size(); i++) {
-      std::cout << locations[i];
+    else{
+      std::cout << "found "<<count<<" solutions."<<std::endl;
+      for (int i = 0; i < count; i++) {
+        std::cout << "This is a solution: ";
+        for(int j=0; j< tiles.size(); j++){
+          std::cout << solutions[i*tiles.size()+j];
+        }
+        std::cout << std::endl;
+      }
     }
-    std::cout << std::endl;
-
-    // print the ASCII art board representation
-    board.Print();
-    std::cout << std::endl;
-  }
-  else
-    std::cout << "did not find a solution" <<std::endl;
-
-  // delete the tiles
-
-}
-if (all_solutions==true && allow_rotations==false){
-  //locations.clear();
-
-  FindAllSolutions(board, tiles, locations, solutions);
-  if(solutions.size()==0){
-    std::cout << "did not find a solution" <<std::endl;
   }
   else{
-    std::cout << "found "<<solutions.size()<<" solutions."<<std::endl;
-    for (int i = 0; i < solutions.size(); i++) {
-      std::cout << "This is a solution: ";
-      for(int j=0; j< tiles.size(); j++){
-        std::cout << solutions[i][j];
-      }
-      std::cout << std::endl;
-    }
-
+    std::vector<Location> locations;
+    if (SolveCached(*solver, ResultCache::FIRST, cache, [&locations](const std::vector<Location>& found) {
+          locations = found;
+        }) > 0)
+      PrintSolution(solver->tileSet(), rows, columns, locations, context);
+    else if (solver->cancelled())
+      std::cout << "stopped at the time limit" <<std::endl;
+    else
+      std::cout << "did not find a solution" <<std::endl;
   }
-}
 
+  delete solver;
+  delete cache;
   for (int t = 0; t < tiles.size(); t++) {
     delete tiles[t];
   }
@@ -0,0 +1,171 @@
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "puzzlefile.h"
+
+
+// a puzzle may not have more tiles than this, counts included
+static const unsigned long long MAX_TILES = 1 << 24;
+
+// the edge names, in the order of Tile::signature's digits
+static const std::string EDGES[3] = { "pasture", "road", "city" };
+
+
+// ==========================================================================
+// Tiny all-public class for one word of the line being scanned, left in
+// place in the text.
+class Token {
+public:
+  Token(const char *b, const char *e) : begin(b), end(e) {}
+  bool empty() const { return begin == end; }
+  bool is(const std::string &word) const {
+    return end-begin == word.size() && memcmp(begin, word.data(), word.size()) == 0;
+  }
+  // only for error messages
+  std::string text() const { return std::string(begin, end); }
+  const char *begin;
+  const char *end;
+};
+
+static bool IsBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// the next word before end, empty once the line is used up
+static Token NextToken(const char *&p, const char *end) {
+  while (p < end && IsBlank(*p)) p++;
+  const char *begin = p;
+  while (p < end && !IsBlank(*p)) p++;
+  return Token(begin, p);
+}
+
+// a count is x and a number of copies, at least 1
+static bool ParseCount(const Token &word, unsigned long long &copies) {
+  if (word.end-word.begin < 2 || word.end-word.begin > 10 || *word.begin != 'x') return false;
+  copies = 0;
+  for (const char *c = word.begin+1; c < word.end; c++) {
+    if (*c < '0' || *c > '9') return false;
+    copies = copies*10 + (*c - '0');
+  }
+  return copies >= 1;
+}
+
+
+// ==========================================================================
+// Reads the tile on one line, if there is one, onto the end of tiles.
+// Returns false, with the reason in error, if the line makes no sense.
+static bool ParseLine(const char *p, const char *end, std::vector<Tile*> &tiles, std::string &error) {
+  Token word = NextToken(p, end);
+  if (word.empty()) return true;
+  if (!word.is("tile")) {
+    error = "expected 'tile', found '" + word.text() + "'";
+    return false;
+  }
+  int edges[4];
+  for (int s = 0; s < 4; s++) {
+    word = NextToken(p, end);
+    if (word.empty()) {
+      error = "a tile needs four edges";
+      return false;
+    }
+    edges[s] = -1;
+    for (int e = 0; e < 3; e++) {
+      if (word.is(EDGES[e])) edges[s] = e;
+    }
+    if (edges[s] < 0) {
+      error = "'" + word.text() + "' is not city, road or pasture";
+      return false;
+    }
+  }
+  unsigned long long copies = 1;
+  word = NextToken(p, end);
+  if (!word.empty()) {
+    if (!ParseCount(word, copies)) {
+      error = "bad count '" + word.text() + "', expected x<n> with n at least 1";
+      return false;
+    }
+    word = NextToken(p, end);
+    if (!word.empty()) {
+      error = "unexpected '" + word.text() + "' after the tile";
+      return false;
+    }
+  }
+
+  const std::string &north = EDGES[edges[0]];
+  const std::string &east  = EDGES[edges[1]];
+  const std::string &south = EDGES[edges[2]];
+  const std::string &west  = EDGES[edges[3]];
+  if (!Tile::legal(north, east, south, west)) {
+    error = "'tile " + north + " " + east + " " + south + " " + west + "' is not a legal tile";
+    return false;
+  }
+  if (tiles.size() + copies > MAX_TILES) {
+    std::ostringstream message;
+    message << "a puzzle may have at most " << MAX_TILES << " tiles";
+    error = message.str();
+    return false;
+  }
+  // the copies skip the checks and string compares of the constructor
+  tiles.push_back(new Tile(north, east, south, west));
+  for (unsigned long long c = 1; c < copies; c++) {
+    tiles.push_back(new Tile(*tiles.back()));
+  }
+  return true;
+}
+
+
+// ==========================================================================
+bool ParsePuzzle(const std::string &text, std::vector<Tile*> &tiles, std::string &error) {
+  const char *p = text.data();
+  const char *end = p + text.size();
+  for (int line = 1; p < end; line++) {
+    const char *newline = (const char*)memchr(p, '\n', end-p);
+    const char *stop = newline != NULL ? newline : end;
+    std::string reason;
+    if (!ParseLine(p, stop, tiles, reason)) {
+      std::ostringstream message;
+      message << "line " << line << ": " << reason;
+      error = message.str();
+      for (int t = 0; t < tiles.size(); t++) {
+        delete tiles[t];
+      }
+      tiles.clear();
+      return false;
+    }
+    p = stop + 1;
+  }
+  return true;
+}
+
+bool ReadPuzzleFile(const std::string &filename, std::vector<Tile*> &tiles, std::string &error) {
+  std::ifstream istr(filename.c_str(), std::ios::binary);
+  if (!istr) {
+    error = "cannot open file '" + filename + "'";
+    return false;
+  }
+
+  // one read for a regular file; anything else is copied as it comes
+  std::string text;
+  istr.seekg(0, std::ios::end);
+  std::streamoff size = istr.tellg();
+  if (size >= 0) {
+    istr.seekg(0, std::ios::beg);
+    text.resize(size);
+    istr.read(&text[0], size);
+    text.resize(istr.gcount());
+  } else {
+    istr.clear();
+    std::ostringstream contents;
+    contents << istr.rdbuf();
+    text = contents.str();
+  }
+
+  if (!ParsePuzzle(text, tiles, error)) {
+    error = filename + " " + error;
+    return false;
+  }
+  return true;
+}
+
+// ==========================================================================
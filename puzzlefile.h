@@ -0,0 +1,29 @@
+#ifndef __PUZZLEFILE_H__
+#define __PUZZLEFILE_H__
+
+#include <string>
+#include <vector>
+
+#include "tile.h"
+
+
+// A puzzle file has one tile per line, its four edges from north to
+// west, each of them city, road or pasture:
+//   tile city road city road
+// A line may end with a count, to stand for that many copies of the tile:
+//   tile city road city road x250
+// Blank lines are skipped.  The text is read in one piece and scanned in
+// place, so a file parses in a single pass with no allocation per line
+// beyond the tiles themselves.  Every check is made here, with NDEBUG or
+// not, so bad input never reaches the asserts in Tile.
+
+// Reads the tiles from the text of a puzzle.  Returns false, with the
+// reason in error as "line <n>: ...", and no tiles, if a line makes no
+// sense.  The caller owns the tiles.
+bool ParsePuzzle(const std::string &text, std::vector<Tile*> &tiles, std::string &error);
+
+// Reads a whole puzzle file and parses it; errors name the file.
+bool ReadPuzzleFile(const std::string &filename, std::vector<Tile*> &tiles, std::string &error);
+
+
+#endif
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "puzzlefile.h"
+
+
+// ==========================================================================
+// Checks the puzzle parser: counts, blank lines and the other spacing it
+// takes, and an error with the right line number, and no tiles left
+// over, for each way a line can go wrong.  Run by make check.
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+void clear(std::vector<Tile*> &tiles) {
+  for (int t = 0; t < tiles.size(); t++)
+    delete tiles[t];
+  tiles.clear();
+}
+
+// the signatures of the tiles the text parses to, or "error: ..."
+std::string parse(const std::string &text) {
+  std::vector<Tile*> tiles;
+  std::string error;
+  if (!ParsePuzzle(text, tiles, error)) {
+    if (!tiles.empty())
+      return "tiles left after '" + error + "'";
+    return "error: " + error;
+  }
+  std::string signatures;
+  for (int t = 0; t < tiles.size(); t++)
+    signatures += (t ? " " : "") + std::to_string(tiles[t]->signature());
+  clear(tiles);
+  return signatures;
+}
+
+void expect(const std::string &text, const std::string &expected) {
+  std::string got = parse(text);
+  check(got == expected, "'" + text + "' gave '" + got + "', expected '" + expected + "'");
+}
+
+
+// ==========================================================================
+int main() {
+  // signatures are base 3 from north to west: pasture 0, road 1, city 2
+  expect("tile road road road road\n", "40");
+  expect("tile city city road road x3\n", "76 76 76");
+  expect("tile road road road road x1", "40");
+  expect("\n  tile\tpasture pasture road road  \r\n\r\n"
+         "tile city city city city x2\n\n", "4 80 80");
+  expect("", "");
+
+  expect("tile road road road road\nfoo road road road road\n",
+         "error: line 2: expected 'tile', found 'foo'");
+  expect("tile road road road\n", "error: line 1: a tile needs four edges");
+  expect("\n\ntile road river road road\n",
+         "error: line 3: 'river' is not city, road or pasture");
+  expect("tile road road road road x0\n",
+         "error: line 1: bad count 'x0', expected x<n> with n at least 1");
+  expect("tile road road road road x\n",
+         "error: line 1: bad count 'x', expected x<n> with n at least 1");
+  expect("tile road road road road 5\n",
+         "error: line 1: bad count '5', expected x<n> with n at least 1");
+  expect("tile road road road road x12345678901\n",
+         "error: line 1: bad count 'x12345678901', expected x<n> with n at least 1");
+  expect("tile road road road road x2 x2\n",
+         "error: line 1: unexpected 'x2' after the tile");
+  expect("tile road city pasture pasture\n",
+         "error: line 1: 'tile road city pasture pasture' is not a legal tile");
+  expect("tile road road road road\ntile road road road road x16777216\n",
+         "error: line 2: a puzzle may have at most 16777216 tiles");
+
+  std::vector<Tile*> tiles;
+  std::string error;
+  check(!ReadPuzzleFile("no such puzzle.txt", tiles, error) &&
+        error == "cannot open file 'no such puzzle.txt'", "a missing file: " + error);
+
+  if (failures > 0)
+    return 1;
+  std::cout << "puzzle parser: ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include <cassert>
+#include <cstring>
+
+#include "renderer.h"
+
+
+// ==========================================================================
+// every output line is numColumns() tiles wide plus a newline; empty
+// cells are left as the blanks the buffer is filled with, so only the
+// bounding box of the tiles is looked at
+const std::string& BoardRenderer::render(const Board &board) {
+  int size = context.tile_size;
+  int line = board.numColumns() * size + 1;
+  buffer.assign((size_t)board.numRows() * size * line, ' ');
+  int min_row, min_column, max_row, max_column;
+  if (!board.boundingBox(min_row, min_column, max_row, max_column)) {
+    min_row = min_column = 0;
+    max_row = max_column = -1;
+  }
+
+  std::string edge = '+' + std::string(size-2,'-') + '+';
+  for (int b = 0; b < board.numRows(); b++) {
+    char *block = &buffer[(size_t)b * size * line];
+    for (int j = min_column; b >= min_row && b <= max_row && j <= max_column; j++) {
+      Tile *t = board.getTile(b,j);
+      if (t == NULL) continue;
+      const std::vector<std::string> &art = t->getAsciiArt(context,board.getRotation(b,j));
+      assert ((int)art.size() == size-2);
+      for (int i = 0; i < size; i++) {
+        char *out = block + i * line + j * size;
+        if (i == 0 || i == size-1) {
+          memcpy(out, edge.data(), size);
+        } else {
+          out[0] = '|';
+          memcpy(out+1, art[i-1].data(), size-2);
+          out[size-1] = '|';
+        }
+      }
+    }
+    for (int i = 0; i < size; i++) {
+      block[i * line + line-1] = '\n';
+    }
+  }
+  return buffer;
+}
+
+
+// ==========================================================================
+void BoardRenderer::print(const Board &board, std::ostream &ostr) {
+  render(board);
+  ostr.write(buffer.data(), buffer.size());
+  ostr.flush();
+}
+
+// ==========================================================================
@@ -0,0 +1,34 @@
+#ifndef __RENDERER_H__
+#define __RENDERER_H__
+
+#include <iostream>
+#include <string>
+#include "board.h"
+
+
+// This class draws a whole board of ASCII art tiles into one character
+// buffer and writes it out with a single call.  The buffer is kept
+// between calls, so rendering a sequence of boards of the same size
+// allocates only once.  Each renderer draws with its own RenderContext.
+
+class BoardRenderer {
+public:
+
+  // CONSTRUCTOR
+  BoardRenderer(const RenderContext &c = RenderContext()) : context(c) {}
+
+  const RenderContext& renderContext() const { return context; }
+  // composes the board into the buffer and returns it
+  const std::string& render(const Board &board);
+  // renders the board and writes it to the stream in one piece
+  void print(const Board &board, std::ostream &ostr);
+
+private:
+
+  // REPRESENTATION
+  RenderContext context;
+  std::string buffer;
+};
+
+
+#endif
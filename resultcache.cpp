@@ -0,0 +1,217 @@
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "resultcache.h"
+
+
+// every file starts with this line, so old or foreign files are ignored
+static const char* const MAGIC = "carcassonne-result 1";
+
+
+// ==========================================================================
+// CONSTRUCTOR
+ResultCache::ResultCache(const std::string &d, unsigned long long m) :
+  directory(d), max_bytes(m) {
+  assert (!directory.empty());
+  mkdir(directory.c_str(), 0777);
+}
+
+
+// ==========================================================================
+// The input tiles sorted by signature, ties in input order: entry k is
+// the input index of the k-th tile in the order the cache stores them.
+static std::vector<int> CanonicalOrder(const TileSet &set) {
+  std::vector<std::pair<int,int> > keyed(set.numTiles());
+  for (int i = 0; i < set.numTiles(); i++) {
+    keyed[i] = std::make_pair(set.type(set.typeOf(i)).signature(), i);
+  }
+  std::sort(keyed.begin(), keyed.end());
+  std::vector<int> order(set.numTiles());
+  for (int k = 0; k < order.size(); k++) {
+    order[k] = keyed[k].second;
+  }
+  return order;
+}
+
+std::string ResultCache::fingerprint(const TileSet &set, int rows, int columns,
+                                     bool allow_rotations, int mode) const {
+  static const char* modes[3] = { "first", "count", "all" };
+  std::vector<int> order = CanonicalOrder(set);
+  std::ostringstream key;
+  key << rows << 'x' << columns << (allow_rotations ? " rotations " : " fixed ") << modes[mode];
+  for (int k = 0; k < order.size(); k++) {
+    key << (k ? ',' : ' ') << set.type(set.typeOf(order[k])).signature();
+  }
+  return key.str();
+}
+
+// the file is named after a 64-bit FNV-1a hash of the fingerprint, and
+// holds the fingerprint itself in case two of them share a hash
+std::string ResultCache::fileFor(const std::string &fingerprint) const {
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < fingerprint.size(); i++) {
+    hash = (hash ^ (unsigned char)fingerprint[i]) * 0x100000001b3ULL;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.result", hash);
+  return directory + "/" + name;
+}
+
+
+// ==========================================================================
+// LOOKUP
+// The file holds the magic line, the fingerprint, the count and the
+// number of solutions kept, and then one solution per line as row,
+// column and quarter turns for each tile in canonical order.
+bool ResultCache::read(const std::string &fingerprint, const TileSet &set,
+                       CachedResult &result) const {
+  std::string file = fileFor(fingerprint);
+  std::ifstream istr(file.c_str());
+  std::string magic, stored;
+  if (!std::getline(istr, magic) || magic != MAGIC ||
+      !std::getline(istr, stored) || stored != fingerprint) return false;
+  unsigned long long count, kept;
+  if (!(istr >> count >> kept)) return false;
+  std::vector<int> order = CanonicalOrder(set);
+  int tiles = order.size();
+  // The file may be corrupt, so kept may be anything.  More solutions
+  // than the count, or than store would have kept, is a miss; the bound
+  // is checked by division, since kept*tiles could wrap around.
+  if (kept > count || (tiles == 0 ? kept != 0 : kept > max_bytes / MIN_LOCATION_BYTES / tiles)) {
+    return false;
+  }
+  std::vector<Location> solutions(kept*tiles, Location(0,0,0));
+  for (unsigned long long s = 0; s < kept; s++) {
+    for (int k = 0; k < tiles; k++) {
+      int row, column, turns;
+      if (!(istr >> row >> column >> turns) || row < 0 || column < 0 || turns < 0 ||
+          row > Location::MAX_COORDINATE || column > Location::MAX_COORDINATE || turns > 3) {
+        return false;
+      }
+      solutions[s*tiles + order[k]] = Location(row, column, turns*90);
+    }
+  }
+  result.count = count;
+  result.solutions.swap(solutions);
+  // a hit makes the file the most recently used
+  utimensat(AT_FDCWD, file.c_str(), NULL, 0);
+  return true;
+}
+
+bool ResultCache::lookup(const TileSet &set, int rows, int columns, bool allow_rotations,
+                         int mode, CachedResult &result) {
+  if (read(fingerprint(set, rows, columns, allow_rotations, mode), set, result)) {
+    return true;
+  }
+  if (mode == ALL || !read(fingerprint(set, rows, columns, allow_rotations, ALL), set, result)) {
+    return false;
+  }
+  // all the solutions answer the other questions too
+  if (mode == COUNT) {
+    result.solutions.clear();
+  } else if (result.count > 0) {
+    result.count = 1;
+    result.solutions.resize(set.numTiles(), Location(0,0,0));
+  }
+  return true;
+}
+
+
+// ==========================================================================
+// STORE
+// The file is written under a name of its own, one solution at a time,
+// and renamed into place, so a reader never sees half of it.  An answer
+// bigger than the whole cache is not kept, as it would only push
+// everything else out; the file is given up as soon as it gets that big.
+void ResultCache::store(const TileSet &set, int rows, int columns, bool allow_rotations,
+                        int mode, const CachedResult &result) {
+  std::string key = fingerprint(set, rows, columns, allow_rotations, mode);
+  std::vector<int> order = CanonicalOrder(set);
+  int tiles = order.size();
+  unsigned long long kept = tiles == 0 ? 0 : result.solutions.size() / tiles;
+  if (!canKeep(kept * tiles)) return;
+
+  std::string file = fileFor(key);
+  std::ostringstream unique;
+  unique << file << ".tmp." << getpid() << '.' << std::hash<std::thread::id>()(std::this_thread::get_id());
+  std::string temporary = unique.str();
+  {
+    std::ofstream ostr(temporary.c_str());
+    std::ostringstream line;
+    line << MAGIC << '\n' << key << '\n' << result.count << ' ' << kept << '\n';
+    unsigned long long bytes = line.str().size();
+    ostr << line.str();
+    for (unsigned long long s = 0; s < kept && bytes <= max_bytes; s++) {
+      line.str("");
+      for (int k = 0; k < tiles; k++) {
+        const Location &loc = result.solutions[s*tiles + order[k]];
+        line << (k ? " " : "") << loc.row << ' ' << loc.column << ' ' << loc.turns;
+      }
+      line << '\n';
+      bytes += line.str().size();
+      ostr << line.str();
+    }
+    ostr.close();
+    if (!ostr || bytes > max_bytes) {
+      unlink(temporary.c_str());
+      return;
+    }
+  }
+  if (rename(temporary.c_str(), file.c_str()) != 0) {
+    unlink(temporary.c_str());
+    return;
+  }
+  evict();
+}
+
+
+// ==========================================================================
+// EVICTION
+static bool OlderFirst(const std::pair<struct timespec, std::string> &a,
+                       const std::pair<struct timespec, std::string> &b) {
+  if (a.first.tv_sec != b.first.tv_sec) return a.first.tv_sec < b.first.tv_sec;
+  return a.first.tv_nsec < b.first.tv_nsec;
+}
+
+// Files are ranked by modification time, which a hit moves forward.
+// Another process may remove a file first, so failures are ignored.
+void ResultCache::evict() {
+  std::lock_guard<std::mutex> guard(evict_lock);
+  DIR *dir = opendir(directory.c_str());
+  if (dir == NULL) return;
+  std::vector<std::pair<struct timespec, std::string> > files;
+  unsigned long long total = 0;
+  const std::string suffix = ".result";
+  for (struct dirent *entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() <= suffix.size() ||
+        name.compare(name.size()-suffix.size(), suffix.size(), suffix) != 0) continue;
+    std::string file = directory + "/" + name;
+    struct stat info;
+    if (stat(file.c_str(), &info) != 0) continue;
+    total += info.st_size;
+    files.push_back(std::make_pair(info.st_mtim, file));
+  }
+  closedir(dir);
+  if (total <= max_bytes) return;
+
+  std::sort(files.begin(), files.end(), OlderFirst);
+  for (int i = 0; i < files.size() && total > max_bytes; i++) {
+    struct stat info;
+    if (stat(files[i].second.c_str(), &info) == 0 && unlink(files[i].second.c_str()) == 0) {
+      total -= std::min<unsigned long long>(total, info.st_size);
+    }
+  }
+}
+
+// ==========================================================================
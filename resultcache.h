@@ -0,0 +1,76 @@
+#ifndef __RESULTCACHE_H__
+#define __RESULTCACHE_H__
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "location.h"
+#include "tileset.h"
+
+
+// Tiny all-public class with the answer to one puzzle: the number of
+// solutions (0 or 1 for a first solution) and the solutions themselves,
+// end to end, one Location per input tile.  A count keeps no solutions.
+class CachedResult {
+public:
+  CachedResult() : count(0) {}
+  unsigned long long count;
+  std::vector<Location> solutions;
+};
+
+
+// This class keeps the answers to puzzles in a directory, one file per
+// puzzle, so that a puzzle seen before is answered without a search.  A
+// puzzle is known by its fingerprint: the sorted multiset of its tile
+// signatures, the board dimensions, whether rotations are allowed and
+// what was asked.  Any order of the same tiles has the same fingerprint,
+// so solutions are stored with the tiles in sorted order and put back in
+// the caller's order on a hit.  Once the files take more than the given
+// number of bytes, the least recently used ones are removed.  Several
+// threads, and several processes, may share one directory.
+
+class ResultCache {
+public:
+
+  // what is asked of a puzzle
+  enum { FIRST = 0, COUNT, ALL };
+
+  // CONSTRUCTOR
+  // creates the directory if there is none
+  ResultCache(const std::string &directory, unsigned long long max_bytes);
+
+  // true, with the answer in result, if the puzzle is in the cache; the
+  // answer for ALL also answers FIRST and COUNT
+  bool lookup(const TileSet &set, int rows, int columns, bool allow_rotations, int mode,
+              CachedResult &result);
+  // keeps the answer, then makes room if the cache is over its size
+  void store(const TileSet &set, int rows, int columns, bool allow_rotations, int mode,
+             const CachedResult &result);
+  // could an answer with this many locations be kept?  Past that there
+  // is no point in holding on to the solutions for store
+  bool canKeep(unsigned long long locations) const {
+    return locations <= max_bytes / MIN_LOCATION_BYTES;
+  }
+
+  // the fewest bytes a location takes in a file, "r c t" and a space
+  enum { MIN_LOCATION_BYTES = 6 };
+
+private:
+
+  // helpers for lookup and store
+  std::string fingerprint(const TileSet &set, int rows, int columns, bool allow_rotations,
+                          int mode) const;
+  std::string fileFor(const std::string &fingerprint) const;
+  bool read(const std::string &fingerprint, const TileSet &set, CachedResult &result) const;
+  // removes the least recently used files until the rest fit
+  void evict();
+
+  // REPRESENTATION
+  std::string directory;
+  unsigned long long max_bytes;
+  std::mutex evict_lock;
+};
+
+
+#endif
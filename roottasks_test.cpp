@@ -0,0 +1,143 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "solver.h"
+#include "puzzlefile.h"
+
+
+// ==========================================================================
+// Checks that the root tasks, handed out lazily by index, cover the same
+// searches the list of every (cell, type, rotation) did: on sparse boards,
+// with a few tiles on many cells, and on dense ones the tiles nearly fill,
+// a count on one thread and on several finds what the eager split found,
+// and so does forEachSolution, solution for solution.  Run by make check.
+
+// puzzle1.txt
+static const char *puzzle1 =
+  "tile road road pasture pasture\n"
+  "tile road pasture pasture road\n"
+  "tile pasture pasture road road\n"
+  "tile pasture road road pasture\n";
+
+// puzzle2.txt
+static const char *puzzle2 =
+  "tile road road road road\n"
+  "tile road road road pasture\n"
+  "tile pasture road road road\n"
+  "tile road pasture road road\n"
+  "tile road road pasture road\n"
+  "tile road road pasture pasture\n"
+  "tile pasture road road pasture\n"
+  "tile pasture pasture road road\n"
+  "tile road pasture pasture road\n";
+
+// puzzle6.txt
+static const char *puzzle6 =
+  "tile road road road road\n"
+  "tile road city pasture road\n"
+  "tile city road road pasture\n"
+  "tile pasture pasture city pasture\n"
+  "tile pasture pasture pasture city\n"
+  "tile pasture road road pasture\n"
+  "tile road pasture pasture road\n"
+  "tile pasture pasture road road\n"
+  "tile road road pasture pasture\n";
+
+// puzzle9.txt
+static const char *puzzle9 =
+  "tile city city city road\n"
+  "tile city road city city\n"
+  "tile pasture road city road\n"
+  "tile pasture road city road\n"
+  "tile road city pasture road\n"
+  "tile pasture road road pasture\n"
+  "tile road road pasture pasture\n"
+  "tile pasture pasture road road\n"
+  "tile city city pasture pasture\n"
+  "tile city pasture pasture city\n"
+  "tile pasture city pasture pasture\n"
+  "tile pasture pasture pasture city\n"
+  "tile pasture pasture pasture city\n";
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+// every solution forEachSolution reports, as the solver prints it, in a
+// fixed order
+std::vector<std::string> allSolutions(const std::vector<Tile*> &tiles, int rows, int columns,
+                                      const SolverOptions &options) {
+  Solver solver(tiles, rows, columns, options);
+  std::vector<std::string> solutions;
+  solver.forEachSolution([&solutions](const std::vector<Location>& locations) {
+    std::ostringstream text;
+    for (int i = 0; i < locations.size(); i++)
+      text << locations[i];
+    solutions.push_back(text.str());
+  });
+  std::sort(solutions.begin(), solutions.end());
+  return solutions;
+}
+
+// expected is what the eager split of the root found
+void checkBoard(const char *puzzle, int rows, int columns, bool rotations,
+                unsigned long long expected, const std::string &name) {
+  std::vector<Tile*> tiles;
+  std::string error;
+  if (!ParsePuzzle(puzzle, tiles, error)) {
+    check(false, name + ": " + error);
+    return;
+  }
+  SolverOptions options;
+  options.allow_rotations = rotations;
+  std::vector<std::string> one;
+  for (int threads = 1; threads <= 3; threads += 2) {
+    options.threads = threads;
+    std::string where = name + " on " + std::to_string(threads) + " thread(s)";
+    Solver solver(tiles, rows, columns, options);
+    unsigned long long count = solver.count();
+    check(count == expected, where + ": count " + std::to_string(count) +
+          ", expected " + std::to_string(expected));
+    std::vector<std::string> solutions = allSolutions(tiles, rows, columns, options);
+    check(solutions.size() == expected, where + ": forEachSolution");
+    check(std::adjacent_find(solutions.begin(), solutions.end()) == solutions.end(),
+          where + ": a solution found twice");
+    if (threads == 1)
+      one = solutions;
+    else
+      check(solutions == one, where + ": not the solutions one thread finds");
+  }
+
+  for (int t = 0; t < tiles.size(); t++)
+    delete tiles[t];
+}
+
+
+// ==========================================================================
+int main() {
+  // sparse: most of the root tasks start on cells no solution can reach
+  // from, and the cells outnumber the workers many times over
+  checkBoard(puzzle1, 60, 60, false, 3481, "puzzle1 60x60");
+  checkBoard(puzzle9, 12, 12, false, 1117, "puzzle9 12x12");
+  checkBoard(puzzle1, 1, 50, false, 0, "puzzle1 1x50");
+
+  // dense: every cell is in every solution, and there are fewer cells
+  // than tasks per cell
+  checkBoard(puzzle1, 2, 2, false, 1, "puzzle1 2x2");
+  checkBoard(puzzle2, 3, 3, true, 576, "puzzle2 3x3");
+  checkBoard(puzzle6, 3, 3, true, 192, "puzzle6 3x3");
+  checkBoard(puzzle6, 4, 4, true, 4416, "puzzle6 4x4");
+
+  if (failures > 0)
+    return 1;
+  std::cout << "root tasks: ok" << std::endl;
+  return 0;
+}
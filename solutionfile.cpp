@@ -0,0 +1,169 @@
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "solutionfile.h"
+
+
+static const char MAGIC[8] = { 'C','A','R','C','S','O','L','1' };
+
+// the buffer is written out once it holds this many bytes
+static const size_t FLUSH_BYTES = 1 << 20;
+
+
+// ==========================================================================
+// helpers for the little-endian numbers in the header and the records
+static void PutNumber(unsigned char *bytes, unsigned long long value, int size) {
+  for (int b = 0; b < size; b++) {
+    bytes[b] = (value >> (8*b)) & 0xff;
+  }
+}
+
+static unsigned long long GetNumber(const unsigned char *bytes, int size) {
+  unsigned long long value = 0;
+  for (int b = size-1; b >= 0; b--) {
+    value = (value << 8) | bytes[b];
+  }
+  return value;
+}
+
+// writes all of the bytes at the offset, false on failure
+static bool WriteAt(int fd, const unsigned char *bytes, size_t size, off_t offset) {
+  while (size > 0) {
+    ssize_t n = pwrite(fd, bytes, size, offset);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    bytes += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+
+// ==========================================================================
+// WRITING
+SolutionWriter::SolutionWriter() : fd(-1), tiles(0), solutions(0), used(0), written(0), failed(false) {}
+
+SolutionWriter::~SolutionWriter() {
+  if (fd >= 0) {
+    close();
+  }
+}
+
+bool SolutionWriter::open(const std::string &filename, int t, int rows, int columns) {
+  assert (fd < 0);
+  assert (t >= 0 && rows > 0 && columns > 0);
+  fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) return false;
+  tiles = t;
+  solutions = 0;
+  failed = false;
+  buffer.assign(FLUSH_BYTES + 4*tiles + SOLUTION_HEADER_BYTES, 0);
+  memcpy(&buffer[0], MAGIC, 8);
+  PutNumber(&buffer[8], tiles, 4);
+  PutNumber(&buffer[12], rows, 4);
+  PutNumber(&buffer[16], columns, 4);
+  PutNumber(&buffer[20], 0, 4);
+  PutNumber(&buffer[24], 0, 8);
+  used = SOLUTION_HEADER_BYTES;
+  written = 0;
+  return true;
+}
+
+void SolutionWriter::write(const std::vector<Location> &solution) {
+  assert (fd >= 0);
+  assert (solution.size() == tiles);
+  unsigned char *bytes = &buffer[used];
+  for (int i = 0; i < tiles; i++) {
+    const Location &loc = solution[i];
+    PutNumber(bytes + 4*i, loc.row | (loc.column << 15) | ((unsigned long long)loc.turns << 30), 4);
+  }
+  used += 4*tiles;
+  solutions++;
+  if (used >= FLUSH_BYTES) {
+    flush();
+  }
+}
+
+void SolutionWriter::flush() {
+  if (used == 0) return;
+  if (!WriteAt(fd, &buffer[0], used, written)) {
+    failed = true;
+  }
+  written += used;
+  used = 0;
+}
+
+bool SolutionWriter::close() {
+  assert (fd >= 0);
+  flush();
+  unsigned char count[8];
+  PutNumber(count, solutions, 8);
+  if (!WriteAt(fd, count, 8, 24)) {
+    failed = true;
+  }
+  if (::close(fd) != 0) {
+    failed = true;
+  }
+  fd = -1;
+  buffer.clear();
+  return !failed;
+}
+
+
+// ==========================================================================
+// READING
+bool SolutionReader::open(const std::string &filename, std::string &error) {
+  istr.open(filename.c_str(), std::ios::binary);
+  if (!istr) {
+    error = "cannot open file '" + filename + "'";
+    return false;
+  }
+  unsigned char header[SOLUTION_HEADER_BYTES];
+  if (!istr.read((char*)header, SOLUTION_HEADER_BYTES) || memcmp(header, MAGIC, 8) != 0) {
+    error = "'" + filename + "' is not a solution file";
+    return false;
+  }
+  unsigned long long t = GetNumber(header+8, 4);
+  rows = GetNumber(header+12, 4);
+  columns = GetNumber(header+16, 4);
+  solutions = GetNumber(header+24, 8);
+  if (t > (unsigned long long)(Location::MAX_COORDINATE+1) * (Location::MAX_COORDINATE+1)) {
+    error = "'" + filename + "' has a bad header";
+    return false;
+  }
+  tiles = t;
+
+  // A file whose writer did not finish has the wrong length.  The header
+  // may be anything, so its numbers are checked against the length by
+  // division rather than multiplied, which could wrap around, and no
+  // record is set aside unless the file holds one.
+  istr.seekg(0, std::ios::end);
+  unsigned long long length = istr.tellg();
+  istr.seekg(SOLUTION_HEADER_BYTES, std::ios::beg);
+  unsigned long long body = length - SOLUTION_HEADER_BYTES;
+  unsigned long long record_bytes = 4 * t;
+  bool fits = (solutions == 0 || record_bytes == 0) ? body == 0 :
+    body % record_bytes == 0 && body / record_bytes == solutions;
+  if (!fits) {
+    error = "'" + filename + "' is truncated or was not closed";
+    return false;
+  }
+  record.resize(solutions == 0 ? 0 : record_bytes);
+  return true;
+}
+
+bool SolutionReader::next(std::vector<Location> &solution) {
+  if (record.empty() || !istr.read((char*)&record[0], record.size())) return false;
+  solution.clear();
+  for (int i = 0; i < tiles; i++) {
+    unsigned long long packed = GetNumber(&record[4*i], 4);
+    solution.push_back(Location(packed & 0x7fff, (packed >> 15) & 0x7fff, (packed >> 30) * 90));
+  }
+  return true;
+}
+
+// ==========================================================================
@@ -0,0 +1,99 @@
+#ifndef __SOLUTIONFILE_H__
+#define __SOLUTIONFILE_H__
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sys/types.h>
+
+#include "location.h"
+
+
+// The binary form of a list of solutions, for programs that read them
+// back by the million.  A file starts with a 32-byte header
+//   8 bytes   "CARCSOL1"
+//   4 bytes   number of tiles
+//   4 bytes   board rows
+//   4 bytes   board columns
+//   4 bytes   zero
+//   8 bytes   number of solutions
+// followed by one record per solution with 4 bytes per tile, in input
+// order: the row in the low 15 bits, the column in the next 15 and the
+// quarter turns in the top 2, as Location packs them.  All numbers are
+// little-endian.  carcassonne_text turns a file back into text.
+
+enum { SOLUTION_HEADER_BYTES = 32 };
+
+
+// This class writes a solution file.  Records are gathered in a large
+// buffer and written out a megabyte at a time; the number of solutions
+// goes into the header when the file is closed.
+
+class SolutionWriter {
+public:
+
+  // CONSTRUCTOR & DESTRUCTOR
+  SolutionWriter();
+  // closes the file if it is still open
+  ~SolutionWriter();
+
+  // creates or truncates the file and writes a header with no solutions,
+  // false if it cannot be created
+  bool open(const std::string &filename, int tiles, int rows, int columns);
+  // adds one solution, with one location per tile
+  void write(const std::vector<Location> &solution);
+  // writes what is left and the count, false if any write failed
+  bool close();
+
+  unsigned long long numSolutions() const { return solutions; }
+
+private:
+
+  // the file is closed once, so the writer must not be copied
+  SolutionWriter(const SolutionWriter&);
+  SolutionWriter& operator=(const SolutionWriter&);
+
+  // writes the buffer to the file and empties it
+  void flush();
+
+  // REPRESENTATION
+  int fd;
+  int tiles;
+  unsigned long long solutions;
+  std::vector<unsigned char> buffer;
+  size_t used;
+  off_t written;   // bytes already in the file
+  bool failed;
+};
+
+
+// This class reads a solution file back, one solution at a time.
+
+class SolutionReader {
+public:
+
+  // false, with the reason in error, if the file cannot be opened or its
+  // header or length is wrong
+  bool open(const std::string &filename, std::string &error);
+
+  int numTiles() const { return tiles; }
+  int numRows() const { return rows; }
+  int numColumns() const { return columns; }
+  unsigned long long numSolutions() const { return solutions; }
+
+  // the next solution, false once there are no more
+  bool next(std::vector<Location> &solution);
+
+private:
+
+  // REPRESENTATION
+  std::ifstream istr;
+  int tiles;
+  int rows;
+  int columns;
+  unsigned long long solutions;
+  std::vector<unsigned char> record;
+};
+
+
+#endif
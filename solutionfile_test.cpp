@@ -0,0 +1,153 @@
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "solutionfile.h"
+
+
+// ==========================================================================
+// Checks the binary solution file: what SolutionWriter writes comes back
+// the same through SolutionReader, and through carcassonne_text as the
+// text the solver prints, while a truncated file, a file that is not a
+// solution file and a header whose numbers would wrap around are
+// turned away.  Run by make check with the build directory, where
+// carcassonne_text is.
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+std::string build;
+
+// the output of carcassonne_text on the file, and its exit status
+std::string toText(const std::string &file, int &status) {
+  std::string command = build + "/carcassonne_text '" + file + "' 2>/dev/null";
+  FILE *pipe = popen(command.c_str(), "r");
+  std::string output;
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), pipe)) > 0)
+    output.append(chunk, n);
+  status = pclose(pipe);
+  return output;
+}
+
+// the text the solver prints for these solutions with -all_solutions
+std::string asText(const std::vector<std::vector<Location> > &solutions) {
+  std::ostringstream text;
+  if (solutions.empty()) {
+    text << "did not find a solution" << std::endl;
+    return text.str();
+  }
+  text << "found " << solutions.size() << " solutions." << '\n';
+  for (int s = 0; s < solutions.size(); s++) {
+    text << "This is a solution: ";
+    for (int i = 0; i < solutions[s].size(); i++)
+      text << solutions[s][i];
+    text << '\n';
+  }
+  return text.str();
+}
+
+void write(const std::string &file, int tiles, const std::vector<std::vector<Location> > &solutions) {
+  SolutionWriter writer;
+  check(writer.open(file, tiles, 40000, 3), "open " + file + " to write");
+  for (int s = 0; s < solutions.size(); s++)
+    writer.write(solutions[s]);
+  check(writer.close(), "close " + file);
+}
+
+// the file's bytes, less the last cut of them
+void truncate(const std::string &file, int cut) {
+  std::ifstream istr(file.c_str(), std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(istr)), std::istreambuf_iterator<char>());
+  istr.close();
+  std::ofstream ostr(file.c_str(), std::ios::binary | std::ios::trunc);
+  ostr.write(bytes.data(), bytes.size() - cut);
+}
+
+void roundTrip(const std::string &file, int tiles, const std::vector<std::vector<Location> > &solutions,
+               const std::string &name) {
+  write(file, tiles, solutions);
+  SolutionReader reader;
+  std::string error;
+  check(reader.open(file, error), name + ": open: " + error);
+  check(reader.numTiles() == tiles && reader.numRows() == 40000 && reader.numColumns() == 3 &&
+        reader.numSolutions() == solutions.size(), name + ": header");
+  std::vector<Location> solution;
+  for (int s = 0; s < solutions.size(); s++)
+    check(reader.next(solution) && solution == solutions[s], name + ": solution read back");
+  check(!reader.next(solution), name + ": nothing after the last solution");
+
+  int status;
+  check(toText(file, status) == asText(solutions) && status == 0, name + ": carcassonne_text");
+}
+
+
+// ==========================================================================
+int main(int argc, char *argv[]) {
+  build = argc > 1 ? argv[1] : "build";
+  std::ostringstream unique;
+  unique << "/tmp/solutionfile_test." << getpid();
+  std::string file = unique.str();
+
+  // every field at its smallest and largest, and enough solutions to
+  // take more than one flush of the writer's buffer
+  std::vector<std::vector<Location> > solutions;
+  for (int s = 0; s < 70000; s++) {
+    std::vector<Location> solution;
+    solution.push_back(Location(s % 3, Location::MAX_COORDINATE, (s % 4) * 90));
+    solution.push_back(Location(Location::MAX_COORDINATE, s % 5, 270));
+    solution.push_back(Location(s % (Location::MAX_COORDINATE+1), 0, 0));
+    solution.push_back(Location(0, s % 7, 90));
+    solutions.push_back(solution);
+  }
+  roundTrip(file, 4, solutions, "70000 solutions");
+  roundTrip(file, 4, std::vector<std::vector<Location> >(), "no solutions");
+
+  SolutionReader reader;
+  std::string error;
+  int status;
+  write(file, 4, solutions);
+  truncate(file, 3);
+  check(!reader.open(file, error) && error == "'" + file + "' is truncated or was not closed",
+        "a truncated file: " + error);
+  check(toText(file, status) == "" && status != 0, "carcassonne_text on a truncated file");
+
+  // a header whose numbers multiply out to the length of a one-record
+  // file modulo 2^64: 3 tiles times 3074457345618258603 solutions times 4
+  // bytes is 4 plus a multiple of 2^64
+  write(file, 1, std::vector<std::vector<Location> >(1, std::vector<Location>(1, Location(0,0,0))));
+  {
+    std::fstream header(file.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+    unsigned char tiles[4] = { 3, 0, 0, 0 };
+    unsigned char count[8] = { 0xab, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0x2a };
+    header.seekp(8);
+    header.write((char*)tiles, 4);
+    header.seekp(24);
+    header.write((char*)count, 8);
+  }
+  SolutionReader wrapped;
+  check(!wrapped.open(file, error), "a header that wraps around");
+
+  std::ofstream(file.c_str()) << "carcassonne\n";
+  SolutionReader foreign;
+  check(!foreign.open(file, error) && error == "'" + file + "' is not a solution file",
+        "a file that is not a solution file: " + error);
+  check(toText(file, status) == "" && status != 0, "carcassonne_text on a file that is not a solution file");
+
+  unlink(file.c_str());
+  if (failures > 0)
+    return 1;
+  std::cout << "solution files: ok" << std::endl;
+  return 0;
+}
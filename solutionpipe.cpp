@@ -0,0 +1,93 @@
+#include <cassert>
+#include <algorithm>
+
+#include "solutionpipe.h"
+
+
+// ==========================================================================
+// CONSTRUCTOR & DESTRUCTOR
+SolutionPipe::SolutionPipe(int t, const SolutionCallback &c, int cap) :
+  tiles(t), capacity(cap), consumer(c), ring((size_t)t*cap, Location(0,0,0)),
+  head(0), tail(0), producer_waiting(false), consumer_waiting(false), aborted(false),
+  closed(false) {
+  assert (tiles >= 0 && cap > 0);
+  writer = std::thread(&SolutionPipe::run, this);
+}
+
+SolutionPipe::~SolutionPipe() {
+  close();
+}
+
+
+// ==========================================================================
+// Each side publishes its position and then looks whether the other side
+// is asleep; a side going to sleep says so and then looks at the other's
+// position once more.  Both are sequentially consistent, so one of the
+// two always sees the other, and no wake-up is lost.
+void SolutionPipe::wakeUp() {
+  std::lock_guard<std::mutex> guard(lock);
+  wake.notify_all();
+}
+
+void SolutionPipe::push(const std::vector<Location> &solution) {
+  assert (solution.size() == tiles);
+  if (aborted.load()) return;
+  unsigned long long t = tail.load(std::memory_order_relaxed);
+  if (t - head.load() == capacity) {
+    std::unique_lock<std::mutex> guard(lock);
+    producer_waiting = true;
+    while (t - head.load() == capacity && !aborted) {
+      wake.wait(guard);
+    }
+    producer_waiting = false;
+    if (aborted) return;
+  }
+  std::copy(solution.begin(), solution.end(), ring.begin() + (t % capacity) * tiles);
+  tail.store(t+1);
+  if (consumer_waiting.load()) {
+    wakeUp();
+  }
+}
+
+void SolutionPipe::run() {
+  std::vector<Location> solution(tiles, Location(0,0,0));
+  unsigned long long h = head.load(std::memory_order_relaxed);
+  for (;;) {
+    if (h == tail.load()) {
+      std::unique_lock<std::mutex> guard(lock);
+      consumer_waiting = true;
+      while (h == tail.load() && !closed && !aborted) {
+        wake.wait(guard);
+      }
+      consumer_waiting = false;
+      // closed, and everything pushed has been taken out
+      if (h == tail.load() || aborted) return;
+    }
+    if (aborted.load()) return;
+    std::vector<Location>::const_iterator record = ring.begin() + (h % capacity) * tiles;
+    std::copy(record, record + tiles, solution.begin());
+    head.store(++h);
+    if (producer_waiting.load()) {
+      wakeUp();
+    }
+    consumer(solution);
+  }
+}
+
+void SolutionPipe::abort() {
+  std::lock_guard<std::mutex> guard(lock);
+  aborted = true;
+  wake.notify_all();
+}
+
+void SolutionPipe::close() {
+  if (!writer.joinable()) return;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    closed = true;
+    wake.notify_all();
+  }
+  writer.join();
+}
+
+// ==========================================================================
@@ -0,0 +1,81 @@
+#ifndef __SOLUTIONPIPE_H__
+#define __SOLUTIONPIPE_H__
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "location.h"
+#include "solver.h"
+
+
+// This class moves solutions off the search thread.  The search pushes
+// each solution into a bounded ring of fixed-size records, and a writer
+// thread of the pipe's own takes them out in order and hands them to the
+// consumer, which formats, writes or sends them.  Pushing copies the
+// locations and never waits unless the ring is full, so a slow file or
+// client holds the search back only once it is a whole ring behind.
+//
+// One thread pushes (the one forEachSolution calls back on) and only
+// the writer thread calls the consumer.  The two sides share nothing but
+// the ring's two positions; the lock is taken only to sleep, when the
+// ring is empty or full, and to wake the side that sleeps.
+//
+// A consumer that stops taking solutions would leave the search stuck in
+// push once the ring is full, where no cancel or time limit can reach
+// it.  Whoever gives up on the output, from any thread and the consumer
+// included, aborts the pipe: push then returns at once and drops what it
+// is given, and the writer thread drops what is still in the ring.
+
+class SolutionPipe {
+public:
+
+  enum { DEFAULT_CAPACITY = 4096 };
+
+  // CONSTRUCTOR & DESTRUCTOR
+  // starts the writer thread for solutions of the given number of tiles
+  SolutionPipe(int tiles, const SolutionCallback &consumer, int capacity = DEFAULT_CAPACITY);
+  // closes the pipe if it is still open
+  ~SolutionPipe();
+
+  // queues one solution, waiting only while the ring is full, or drops
+  // it once the pipe is aborted
+  void push(const std::vector<Location> &solution);
+  // the consumer gets no more solutions; safe from any thread
+  void abort();
+  // waits until the consumer has had every solution, unless the pipe
+  // was aborted, then stops the writer thread; nothing may be pushed
+  // after this
+  void close();
+
+private:
+
+  // the writer thread is joined once, so the pipe must not be copied
+  SolutionPipe(const SolutionPipe&);
+  SolutionPipe& operator=(const SolutionPipe&);
+
+  // the writer thread
+  void run();
+  // with the lock taken, so a side about to sleep cannot miss it
+  void wakeUp();
+
+  // REPRESENTATION
+  int tiles;
+  unsigned long long capacity;
+  SolutionCallback consumer;
+  std::vector<Location> ring;               // capacity records of tiles each
+  std::atomic<unsigned long long> head;     // records taken out, ever
+  std::atomic<unsigned long long> tail;     // records pushed, ever
+  std::atomic<bool> producer_waiting;
+  std::atomic<bool> consumer_waiting;
+  std::atomic<bool> aborted;                // set with the lock taken
+  std::mutex lock;
+  std::condition_variable wake;
+  bool closed;                              // guarded by lock
+  std::thread writer;
+};
+
+
+#endif
@@ -0,0 +1,162 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <future>
+#include <unistd.h>
+
+#include "solver.h"
+#include "solutionpipe.h"
+#include "puzzlefile.h"
+
+
+// ==========================================================================
+// Checks the solution pipe: every solution comes out of it in the order
+// the search found them, and a search stuck waiting for room in a full
+// pipe, behind a consumer that takes nothing more, comes back once it is
+// cancelled and the pipe aborted, as the daemon does.  A consumer that
+// aborts the pipe itself gets nothing after that.  Run by make check.
+
+// puzzle2.txt
+static const char *puzzle =
+  "tile road road road road\n"
+  "tile road road road pasture\n"
+  "tile pasture road road road\n"
+  "tile road pasture road road\n"
+  "tile road road pasture road\n"
+  "tile road road pasture pasture\n"
+  "tile pasture road road pasture\n"
+  "tile pasture pasture road road\n"
+  "tile road pasture pasture road\n";
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+// Tiny all-public class for a consumer that takes one solution and then
+// waits until it is let go.
+class StuckConsumer {
+public:
+  StuckConsumer() : taken(0), released(false) {}
+  int taken;
+  bool released;
+  std::promise<void> first;
+  std::mutex lock;
+  std::condition_variable wake;
+};
+
+// all the solutions, straight from the solver
+std::vector<std::vector<Location> > solveAll(const std::vector<Tile*> &tiles, int rows, int columns) {
+  SolverOptions options;
+  options.allow_rotations = true;
+  Solver solver(tiles, rows, columns, options);
+  std::vector<std::vector<Location> > solutions;
+  solver.forEachSolution([&solutions](const std::vector<Location>& locations) {
+    solutions.push_back(locations);
+  });
+  return solutions;
+}
+
+void checkInOrder(const std::vector<Tile*> &tiles) {
+  std::vector<std::vector<Location> > expected = solveAll(tiles, 3, 3);
+  std::vector<std::vector<Location> > piped;
+  SolverOptions options;
+  options.allow_rotations = true;
+  Solver solver(tiles, 3, 3, options);
+  {
+    SolutionPipe pipe(tiles.size(), [&piped](const std::vector<Location>& locations) {
+      piped.push_back(locations);
+    }, 7);
+    solver.forEachSolution([&pipe](const std::vector<Location>& locations) {
+      pipe.push(locations);
+    });
+    pipe.close();
+  }
+  check(!expected.empty() && piped == expected, "the pipe hands over every solution in order");
+}
+
+void checkCancelWhileFull(const std::vector<Tile*> &tiles) {
+  SolverOptions options;
+  options.allow_rotations = true;
+  Solver solver(tiles, 4, 4, options);
+  StuckConsumer stuck;
+  SolutionPipe pipe(tiles.size(), [&stuck](const std::vector<Location>&) {
+    std::unique_lock<std::mutex> guard(stuck.lock);
+    if (stuck.taken++ == 0)
+      stuck.first.set_value();
+    while (!stuck.released)
+      stuck.wake.wait(guard);
+  }, 2);
+  std::future<unsigned long long> search = std::async(std::launch::async, [&solver, &pipe]() {
+    return solver.forEachSolution([&pipe](const std::vector<Location>& locations) {
+      pipe.push(locations);
+    });
+  });
+
+  // once the consumer is stuck the two records fill up at once, and the
+  // search is left waiting in push
+  stuck.first.get_future().wait();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  check(search.wait_for(std::chrono::seconds(0)) == std::future_status::timeout,
+        "the search waits while the pipe is full");
+  solver.cancel();
+  pipe.abort();
+  if (search.wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+    std::cerr << "FAILED: a cancelled search stays stuck on a full pipe" << std::endl;
+    _exit(1);
+  }
+  search.get();
+  check(solver.cancelled(), "the search was cancelled");
+  {
+    std::lock_guard<std::mutex> guard(stuck.lock);
+    stuck.released = true;
+    stuck.wake.notify_all();
+  }
+  pipe.close();
+  check(stuck.taken == 1, "nothing reaches the consumer after the pipe is aborted");
+}
+
+void checkConsumerAborts(const std::vector<Tile*> &tiles) {
+  SolverOptions options;
+  options.allow_rotations = true;
+  Solver solver(tiles, 4, 4, options);
+  int taken = 0;
+  SolutionPipe *pipe = NULL;
+  pipe = new SolutionPipe(tiles.size(), [&taken, &pipe](const std::vector<Location>&) {
+    if (++taken == 5)
+      pipe->abort();
+  }, 3);
+  unsigned long long count = solver.forEachSolution([pipe](const std::vector<Location>& locations) {
+    pipe->push(locations);
+  });
+  pipe->close();
+  delete pipe;
+  check(count > 5 && taken == 5, "a consumer that aborts the pipe gets nothing more");
+}
+
+
+// ==========================================================================
+int main() {
+  std::vector<Tile*> tiles;
+  std::string error;
+  if (!ParsePuzzle(puzzle, tiles, error)) {
+    std::cerr << "ERROR: " << error << std::endl;
+    return 1;
+  }
+
+  checkInOrder(tiles);
+  checkCancelWhileFull(tiles);
+  checkConsumerAborts(tiles);
+
+  for (int t = 0; t < tiles.size(); t++)
+    delete tiles[t];
+  if (failures > 0)
+    return 1;
+  std::cout << "solution pipe: ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,1465 @@
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <climits>
+#include <mutex>
+#include <set>
+#include <map>
+#include <condition_variable>
+
+#include "MersenneTwister.h"
+
+#include "solver.h"
+#include "transposition.h"
+#include "trail.h"
+#include "allocations.h"
+
+// ==========================================================================
+// with the allocation hook (see allocations.h), tells how many heap
+// allocations the workers made while they searched
+void ReportSearchAllocations(unsigned long long count) {
+#ifdef COUNT_ALLOCATIONS
+  std::cerr << "heap allocations during the search: " << count << std::endl;
+#endif
+}
+
+
+//===========================================================================
+// SEARCH STATE
+// Cells are numbered row by row.  A cell is FREE until it first touches
+// the layout; it then waits on the FRONTIER until the search either puts
+// a tile there (PLACED) or decides to leave it empty for the rest of the
+// branch (EXCLUDED).  Deciding every frontier cell one way or the other
+// visits each connected layout exactly once (Redelmeier's method).
+enum { FREE = 0, FRONTIER, PLACED, EXCLUDED };
+
+// the cell across each side, in NORTH_EDGE, EAST_EDGE, SOUTH_EDGE,
+// WEST_EDGE bit order
+static const int side_row[4] = { -1, 0, 1, 0 };
+static const int side_col[4] = { 0, 1, 0, -1 };
+
+// kinds of trail records, one per piece of state the search changes
+enum { UNDO_STATUS = 0, UNDO_TILE, UNDO_HEAD, UNDO_TAIL, UNDO_SWAP };
+
+// stamps in SearchState::nogood other than a start cell, see NOGOODS
+enum { NOGOOD_NONE = -2, NOGOOD_ALWAYS = -1 };
+
+// Tiny all-public class holding everything the recursive search updates.
+// The layout and the count of tiles left of each type live in the board.
+// Frontier cells sit in queue[head..tail) in the order they were reached;
+// each cell joins the frontier at most once along a branch, so the queue
+// never needs more room than the board has cells.  Every change goes
+// through the helpers below, which log it on the trail.
+//
+// The cells before the root's start cell stay empty without being
+// written down (see CellStatus), so a root branch starts in constant time
+// however large the board.
+//
+// All memory the search needs is set aside here, or by the solver's
+// reset for backjumping and nogoods, so the recursion itself never
+// touches the heap.  A branch reaches at most one cell per tile side
+// plus the start cell, and decides each at one level, so the queue and
+// the per-level rows are sized by that and not by the board.  Along
+// one branch the trail holds at most four records per cell taken off
+// the frontier (swap, head, tile or status, status) and two per cell put
+// on it (status, tail).
+class SearchState {
+public:
+  SearchState(Board& b, TranspositionTable& t) :
+    board(b), set(b.tileSet()), tt(t), order(ORDER_QUEUE), placed(0),
+    hashing(t.enabled()), decided_hash(0), interior_hash(0), table_hits(0),
+    status(b.numRows()*b.numColumns(), FREE),
+    reach(std::min(b.numRows()*b.numColumns(), 4*set.numTiles()+1)),
+    queue(reach), head(0), tail(0),
+    trail(6*reach),
+    locations(set.numTiles(), Location(0,0,0)), used(set.numTypes()),
+    placed_cells(set.numTiles()),
+    backjump(false), learn(false), root(0),
+    words((reach+2)/64+1),
+    winner(NULL), cancel_below(LLONG_MAX), stop(NULL), nodes(0), node_limit(ULLONG_MAX),
+    type_order(set.numTypes()) {
+    for (int t=0; t<set.numTypes(); t++){
+      type_order[t] = t;
+      rotation_order.push_back(set.type(t).distinctRotations());
+    }
+  }
+  Board& board;
+  const TileSet& set;
+  TranspositionTable& tt;
+  int order;                           // ORDER_QUEUE, ORDER_FEWEST or ORDER_EDGES
+  int placed;                          // tiles on the board
+  // the key for the transposition table, see TABLE KEY below; only kept
+  // up to date while there is a table
+  bool hashing;
+  unsigned long long decided_hash;     // cells PLACED or EXCLUDED
+  unsigned long long interior_hash;    // placements with only decided cells around them
+  unsigned long long table_hits;       // subtrees the table answered for
+  std::vector<char> status;            // FREE, FRONTIER, PLACED or EXCLUDED per cell
+  int reach;                           // most cells one branch can reach
+  std::vector<int> queue;              // frontier cells in the order they were reached
+  int head;
+  int tail;
+  Trail trail;
+  std::vector<Location> locations;     // scratch for LayoutToLocations
+  std::vector<int> used;               // scratch for LayoutToLocations
+  std::vector<int> placed_cells;       // scratch for LayoutToLocations
+  // backjumping, see CONFLICTS below; levels run from 0 to reach+1.  The
+  // rows below are set aside by the solver only if it backjumps, since
+  // the conflict rows grow with the square of the reach.
+  bool backjump;
+  bool learn;                          // keep nogoods
+  int root;                            // the root's current start cell
+  std::vector<int> level_of;           // level that decided each cell
+  std::vector<int> level_type;         // type placed at each level, -1 if a cell was left empty
+  int words;                           // 64-bit words per conflict row
+  std::vector<unsigned long long> conflicts;  // one bit row per level
+  // one bit row per type of the levels that placed it, then one for all
+  // types; bits for the current level and deeper are left over from
+  // other branches
+  std::vector<unsigned long long> placement_levels;
+  std::vector<int> nogood;             // stamp per (cell, type, quarter turn), set
+                                       // aside by the solver only if it keeps nogoods
+  // first-solution mode with threads: the search is cancelled once the
+  // winning task, shared by all workers, is below cancel_below
+  const std::atomic<long long>* winner;
+  long long cancel_below;
+  // any mode: the search is cancelled once the solver's stop flag is set
+  const std::atomic<bool>* stop;
+  // first-solution mode with restarts: the search is cancelled once it
+  // has visited node_limit nodes
+  unsigned long long nodes;
+  unsigned long long node_limit;
+  // the order tile types, and the rotations of each type, are tried in;
+  // without rotations only the first rotation is tried, so it must stay 0
+  std::vector<int> type_order;
+  std::vector<std::vector<int> > rotation_order;
+};
+
+// Has the caller given up on the search, through a cancel or the time
+// limit?
+bool Stopped(const SearchState& s){
+  return s.stop != NULL && s.stop->load(std::memory_order_relaxed);
+}
+
+// Has another worker made the rest of this search pointless, has it run
+// out of nodes, or has the caller given up on it?  A cancelled search
+// returns at once without storing anything, since its counts are not
+// real.
+bool Cancelled(const SearchState& s){
+  if (s.nodes >= s.node_limit)
+    return true;
+  if (Stopped(s))
+    return true;
+  return s.winner != NULL && s.winner->load(std::memory_order_relaxed) < s.cancel_below;
+}
+
+//===========================================================================
+// A cell before the root's start cell that nothing has been written to
+// is EXCLUDED: the root assumes those cells stay empty.  Nothing is ever
+// written to them, since only FREE cells join the frontier.
+char CellStatus(const SearchState& s, int cell){
+  char status = s.status[cell];
+  return (status == FREE && cell < s.root) ? EXCLUDED : status;
+}
+
+//===========================================================================
+// TABLE KEY
+// How many ways a layout can be completed depends only on the cells not
+// decided yet, the tiles placed next to them and the tiles left over: a
+// tile with nothing but decided cells around it can neither block nor
+// be matched by anything still to come.  So the key for the table is
+// made of just those three, and two branches that put the same tiles in
+// the middle of a layout in different cells share an entry.  Without
+// that, the canonical branching would never reach one state twice.  The
+// decided cells are hashed as a set, PLACED or EXCLUDED alike, and the
+// tiles left over come from the board's hash, which is XORed with every
+// placement that is not next to an undecided cell to take it out again.
+
+// a pseudo-random key per cell
+unsigned long long CellKey(int cell){
+  unsigned long long x = (unsigned long long)cell * 0x9e3779b97f4a7c15ULL + 0x632be59bd9b4e019ULL;
+  x = (x ^ (x >> 31)) * 0xbf58476d1ce4e5b9ULL;
+  return x ^ (x >> 29);
+}
+
+// the cells the root leaves empty are all those before its start cell,
+// so they are keyed by the start cell alone
+unsigned long long RootKey(int root){
+  return CellKey(-1 - root);
+}
+
+bool Decided(char status){
+  return status == PLACED || status == EXCLUDED;
+}
+
+// Is the cell a placed tile with an undecided cell next to it?
+bool OnEdge(const SearchState& s, int cell){
+  if (s.status[cell] != PLACED)
+    return false;
+  int r = cell / s.board.numColumns();
+  int c = cell % s.board.numColumns();
+  int border = s.board.borderMask(r, c);
+  for (int side=0; side<4; side++){
+    if (!(border & (1 << side)) &&
+        !Decided(CellStatus(s, (r + side_row[side]) * s.board.numColumns() + c + side_col[side])))
+      return true;
+  }
+  return false;
+}
+
+// XORs the placements of the cell and its neighbors that are not on the
+// edge of the layout into interior_hash, so doing it before and after a
+// change leaves in the ones whose standing changed
+void FlipInterior(SearchState& s, int cell){
+  int r = cell / s.board.numColumns();
+  int c = cell % s.board.numColumns();
+  int border = s.board.borderMask(r, c);
+  for (int side=-1; side<4; side++){
+    if (side >= 0 && (border & (1 << side)))
+      continue;
+    int nr = side < 0 ? r : r + side_row[side];
+    int nc = side < 0 ? c : c + side_col[side];
+    int other = nr * s.board.numColumns() + nc;
+    if (s.status[other] == PLACED && !OnEdge(s, other))
+      s.interior_hash ^= s.board.placementKey(nr, nc, s.board.getPlacement(nr, nc));
+  }
+}
+
+// the key of the layout on the board
+unsigned long long TableKey(const SearchState& s){
+  return s.board.hash() ^ s.interior_hash ^ s.decided_hash ^ RootKey(s.root);
+}
+
+// Changes the status of a cell without logging it.  A cell going into
+// or out of PLACED or EXCLUDED changes the key; a tile placed there is
+// already on the board, and one taken back is still there, so its
+// placement can be read either way.
+void WriteStatus(SearchState& s, int cell, char status){
+  bool flip = s.hashing && Decided(s.status[cell]) != Decided(status);
+  if (flip)
+    FlipInterior(s, cell);
+  s.status[cell] = status;
+  if (flip){
+    s.decided_hash ^= CellKey(cell);
+    FlipInterior(s, cell);
+  }
+}
+
+void SetStatus(SearchState& s, int cell, char status){
+  s.trail.push(UNDO_STATUS, cell, s.status[cell]);
+  WriteStatus(s, cell, status);
+}
+
+// puts a FREE cell at the back of the frontier
+void Enqueue(SearchState& s, int cell){
+  SetStatus(s, cell, FRONTIER);
+  s.trail.push(UNDO_TAIL, 0, s.tail);
+  s.queue[s.tail++] = cell;
+}
+
+// takes the cell at the front of the frontier off the queue; its status
+// is left for the caller to decide
+int Dequeue(SearchState& s){
+  s.trail.push(UNDO_HEAD, 0, s.head);
+  return s.queue[s.head++];
+}
+
+// swaps queue[k] to the front of the frontier
+void MoveToFront(SearchState& s, int k){
+  if (k == s.head)
+    return;
+  s.trail.push(UNDO_SWAP, k, 0);
+  std::swap(s.queue[s.head], s.queue[k]);
+}
+
+//===========================================================================
+// Takes back every change logged since the mark, newest first.
+void Rewind(SearchState& s, int mark){
+  while (s.trail.above(mark)){
+    TrailEntry e = s.trail.pop();
+    switch (e.kind){
+    case UNDO_STATUS:
+      WriteStatus(s, e.where, e.old);
+      break;
+    case UNDO_TILE:
+      s.board.setTile(e.where / s.board.numColumns(), e.where % s.board.numColumns(), Placement());
+      s.placed--;
+      break;
+    case UNDO_HEAD:
+      s.head = e.old;
+      break;
+    case UNDO_TAIL:
+      s.tail = e.old;
+      break;
+    case UNDO_SWAP:
+      // the head is back where it was when the swap was made
+      std::swap(s.queue[s.head], s.queue[e.where]);
+      break;
+    }
+  }
+}
+
+//===========================================================================
+// Tiny all-public class summing up what the four neighbors of a cell ask
+// of a tile put there, as masks of sides (NORTH_EDGE, etc.), so each
+// candidate tile is checked with a few mask operations.
+class Neighborhood {
+public:
+  int border;    // sides facing off the board
+  int empty;     // sides facing a cell that will stay empty
+  int placed;    // sides facing a placed tile
+  int open;      // sides where that tile has a road or city facing the cell
+  int city;      // sides where that tile has a city facing the cell
+  int level[4];  // level that decided the neighbor on each side, see CONFLICTS
+};
+
+Neighborhood GetNeighborhood(const SearchState& s, int cell){
+  Neighborhood n;
+  int r = cell / s.board.numColumns();
+  int c = cell % s.board.numColumns();
+  n.border = s.board.borderMask(r, c);
+  n.empty = n.placed = n.open = n.city = 0;
+  for (int side=0; side<4; side++){
+    int bit = 1 << side;
+    if (n.border & bit)
+      continue;
+    int nr = r + side_row[side];
+    int nc = c + side_col[side];
+    int other = nr * s.board.numColumns() + nc;
+    char status = CellStatus(s, other);
+    n.level[side] = (!s.backjump || (other < s.root && status == EXCLUDED)) ? 0 : s.level_of[other];
+    if (status == EXCLUDED)
+      n.empty |= bit;
+    else if (status == PLACED){
+      int facing = 1 << ((side+2)%4);
+      Placement p = s.board.getPlacement(nr, nc);
+      const TileType& type = s.set.type(p.type);
+      n.placed |= bit;
+      if (type.openEdges(p.degrees()) & facing)
+        n.open |= bit;
+      if (type.cityEdges(p.degrees()) & facing)
+        n.city |= bit;
+    }
+  }
+  return n;
+}
+
+//===========================================================================
+// Can the type, turned by rotation, go into the cell?  Each side must
+// agree with a placed neighbor, and a road or city side must not face
+// the edge of the board or a cell that will stay empty.
+bool Fits(const Neighborhood& n, const TileType& type, int rotation){
+  int open = type.openEdges(rotation);
+  int city = type.cityEdges(rotation);
+  if (open & (n.border | n.empty))
+    return false;
+  return (n.placed & ((open ^ n.open) | (city ^ n.city))) == 0;
+}
+
+// Number of roads and cities on placed neighbors that point into the cell.
+int EdgesInto(const Neighborhood& n){
+  static const int bits[16] = { 0,1,1,2, 1,2,2,3, 1,2,2,3, 2,3,3,4 };
+  return bits[n.open];
+}
+
+// A cell must be filled if a placed neighbor has a road or city facing it.
+bool Forced(const Neighborhood& n){
+  return n.open != 0;
+}
+
+//===========================================================================
+// Puts a tile of type t in the cell and adds the newly reached cells to
+// the back of the frontier.  Rewind() takes it all back.
+void Place(SearchState& s, int cell, int t, int rotation){
+  int r = cell / s.board.numColumns();
+  int c = cell % s.board.numColumns();
+  s.trail.push(UNDO_TILE, cell, 0);
+  s.board.setTile(r, c, Placement(t, rotation));
+  s.placed++;
+  SetStatus(s, cell, PLACED);
+  int border = s.board.borderMask(r, c);
+  for (int side=0; side<4; side++){
+    if (border & (1 << side))
+      continue;
+    int n = (r + side_row[side]) * s.board.numColumns() + c + side_col[side];
+    if (CellStatus(s, n) == FREE)
+      Enqueue(s, n);
+  }
+}
+
+//===========================================================================
+// CELL ORDER
+// Any frontier cell can be decided next without finding a layout twice,
+// so the order is a free choice.  ORDER_QUEUE takes the cell reached
+// first.  ORDER_FEWEST takes the cell with the fewest (type, rotation)
+// choices that fit, and ORDER_EDGES the cell with the most roads and
+// cities pointing into it; ties go to the other measure and then to the
+// cell reached first, so the order is the same on every run.
+
+// number of (type, rotation) choices that fit the cell, counting stops
+// once it is past limit
+template <bool AllowRotations>
+int CountFits(const SearchState& s, const Neighborhood& n, int limit){
+  int fits = 0;
+  for (int t=0; t<s.set.numTypes() && fits<=limit; t++){
+    if (s.board.numRemaining(t) == 0)
+      continue;
+    const std::vector<int>& rotations = s.set.type(t).distinctRotations();
+    for (int k=0; k<(AllowRotations ? rotations.size() : 1); k++){
+      if (Fits(n, s.set.type(t), rotations[k]))
+        fits++;
+    }
+  }
+  return fits;
+}
+
+// Moves the cell picked by the order to the front of the frontier and
+// returns it.  A cell that has to be filled but that nothing fits ends
+// the branch, so it is taken at once.
+template <bool AllowRotations>
+int ChooseCell(SearchState& s){
+  if (s.order == ORDER_QUEUE)
+    return s.queue[s.head];
+  int best = s.head;
+  Neighborhood n = GetNeighborhood(s, s.queue[best]);
+  int best_edges = EdgesInto(n);
+  int all = s.set.numTypes()*4;
+  int best_fits = CountFits<AllowRotations>(s, n, all);
+  for (int k=s.head+1; k<s.tail && !(best_fits==0 && best_edges>0); k++){
+    n = GetNeighborhood(s, s.queue[k]);
+    int edges = EdgesInto(n);
+    if (s.order == ORDER_EDGES && edges < best_edges)
+      continue;
+    int fits = CountFits<AllowRotations>(s, n, edges > best_edges ? all : best_fits);
+    if (s.order == ORDER_FEWEST && fits > best_fits)
+      continue;
+    bool better;
+    if (s.order == ORDER_FEWEST)
+      better = fits < best_fits || edges > best_edges;
+    else
+      better = edges > best_edges || fits < best_fits;
+    if (better){
+      best = k;
+      best_edges = edges;
+      best_fits = fits;
+    }
+  }
+  MoveToFront(s, best);
+  return s.queue[s.head];
+}
+
+//===========================================================================
+// Converts the layout on the board into one Location per input tile,
+// left in s.locations.  Identical tiles are interchangeable, so they are
+// handed out to the cells holding their type in row-major order.  Every
+// placed cell has been taken off the frontier, so they are found in
+// queue[0..head) rather than by a walk over the whole board.
+void LayoutToLocations(SearchState& s){
+  std::vector<Location>& locations = s.locations;
+  std::vector<int>& used = s.used;
+  for (int t=0; t<used.size(); t++)
+    used[t] = 0;
+  int n = 0;
+  for (int k=0; k<s.head; k++){
+    if (s.status[s.queue[k]] == PLACED)
+      s.placed_cells[n++] = s.queue[k];
+  }
+  assert (n == s.set.numTiles());
+  std::sort(s.placed_cells.begin(), s.placed_cells.begin()+n);
+  for (int k=0; k<n; k++){
+    int cell = s.placed_cells[k];
+    int r = cell / s.board.numColumns();
+    int c = cell % s.board.numColumns();
+    Placement p = s.board.getPlacement(r, c);
+    locations[s.set.tilesOfType(p.type)[used[p.type]++]] = Location(r, c, p.degrees());
+  }
+}
+
+//===========================================================================
+// CONFLICTS
+// With backjumping on, every decision is tagged with its level, the depth
+// of the Search call that made it (the root's own assumptions, that the
+// cells before the start cell stay empty and the start cell is used, are
+// level 0).  When an option fails, the levels of the decisions that made
+// it fail go into the conflict set of the current level.  A cell that has
+// no option left hands its conflict set back to its parent; if the
+// parent's own decision is not in it, changing that decision cannot help
+// and the parent gives up at once, and so on up to the latest level that
+// is in the set.  Since only subtrees without solutions are cut, every
+// mode finds the same solutions in the same order as without it.
+//
+// A placement that fails with an empty conflict set is a nogood for the
+// rest of the search, and one that fails because of level 0 alone is a
+// nogood until the root moves on to the next start cell.
+
+unsigned long long* ConflictRow(SearchState& s, int level){
+  return &s.conflicts[level*s.words];
+}
+
+void ClearConflicts(SearchState& s, int level){
+  unsigned long long* row = ConflictRow(s, level);
+  for (int w=0; w<s.words; w++)
+    row[w] = 0;
+}
+
+void AddConflict(SearchState& s, int level, int culprit){
+  ConflictRow(s, level)[culprit/64] |= 1ULL << (culprit%64);
+}
+
+bool InConflict(SearchState& s, int level, int culprit){
+  return (ConflictRow(s, level)[culprit/64] >> (culprit%64)) & 1;
+}
+
+// adds the bits of src for the levels above this one
+void AddConflictRow(SearchState& s, int level, const unsigned long long* src){
+  unsigned long long* row = ConflictRow(s, level);
+  int full = level/64;
+  for (int w=0; w<full; w++)
+    row[w] |= src[w];
+  row[full] |= src[full] & ((1ULL << (level%64)) - 1);
+}
+
+// every level above this one
+void AddAllConflicts(SearchState& s, int level){
+  unsigned long long* row = ConflictRow(s, level);
+  for (int w=0; w<level/64; w++)
+    row[w] = ~0ULL;
+  row[level/64] |= (1ULL << (level%64)) - 1;
+}
+
+// the levels that put a tile of type t on the board (t = -1 for any type)
+void AddPlacementConflicts(SearchState& s, int level, int t){
+  if (t < 0)
+    t = s.set.numTypes();
+  AddConflictRow(s, level, &s.placement_levels[t*s.words]);
+}
+
+// records what the decision at this level was, t = -1 for a cell left empty
+void SetLevelType(SearchState& s, int level, int t){
+  unsigned long long bit = 1ULL << (level%64);
+  int old = s.level_type[level];
+  if (old >= 0){
+    s.placement_levels[old*s.words + level/64] &= ~bit;
+    s.placement_levels[s.set.numTypes()*s.words + level/64] &= ~bit;
+  }
+  if (t >= 0){
+    s.placement_levels[t*s.words + level/64] |= bit;
+    s.placement_levels[s.set.numTypes()*s.words + level/64] |= bit;
+  }
+  s.level_type[level] = t;
+}
+
+// adds the conflict set of the level below, minus this level's decision
+void MergeConflicts(SearchState& s, int level){
+  unsigned long long* row = ConflictRow(s, level);
+  unsigned long long* below = ConflictRow(s, level+1);
+  for (int w=0; w<s.words; w++)
+    row[w] |= below[w];
+  row[level/64] &= ~(1ULL << (level%64));
+}
+
+// Which decision made the type, turned by rotation, not fit the cell?
+// Returns the earliest level among the neighbors it clashes with, or -1
+// if it only clashes with the edge of the board.
+int FitsCulprit(const Neighborhood& n, const TileType& type, int rotation){
+  int open = type.openEdges(rotation);
+  int city = type.cityEdges(rotation);
+  int clash = (open & n.empty) | (n.placed & ((open ^ n.open) | (city ^ n.city)));
+  int culprit = -1;
+  for (int side=0; side<4; side++){
+    if ((clash & (1 << side)) && (culprit < 0 || n.level[side] < culprit))
+      culprit = n.level[side];
+  }
+  return culprit;
+}
+
+// Which decision keeps the cell from being left empty?  The earliest
+// placed neighbor with a road or city pointing into it.
+int ForcedCulprit(const Neighborhood& n){
+  int culprit = -1;
+  for (int side=0; side<4; side++){
+    if ((n.open & (1 << side)) && (culprit < 0 || n.level[side] < culprit))
+      culprit = n.level[side];
+  }
+  assert (culprit >= 0);
+  return culprit;
+}
+
+//===========================================================================
+// NOGOODS
+int NogoodIndex(const SearchState& s, int cell, int t, int rotation){
+  return (cell*s.set.numTypes() + t)*4 + rotation/90;
+}
+
+// Is the placement a nogood?  One that holds only for this start cell
+// depends on the root's decisions, so level 0 joins the conflict set.
+bool Forbidden(SearchState& s, int level, int cell, int t, int rotation){
+  int stamp = s.nogood[NogoodIndex(s, cell, t, rotation)];
+  if (stamp == NOGOOD_ALWAYS)
+    return true;
+  if (stamp == s.root){
+    AddConflict(s, level, 0);
+    return true;
+  }
+  return false;
+}
+
+// Records the placement as a nogood if the conflict set in the row of
+// the given level (leaving out bit skip) is empty or holds only level 0.
+void Learn(SearchState& s, int level, int skip, int cell, int t, int rotation){
+  if (!s.learn)
+    return;
+  unsigned long long* row = ConflictRow(s, level);
+  bool root = false;
+  for (int w=0; w<s.words; w++){
+    unsigned long long bits = row[w];
+    if (w == skip/64)
+      bits &= ~(1ULL << (skip%64));
+    if (w == 0){
+      root = bits & 1;
+      bits &= ~1ULL;
+    }
+    if (bits)
+      return;
+  }
+  s.nogood[NogoodIndex(s, cell, t, rotation)] = root ? s.root : NOGOOD_ALWAYS;
+}
+
+//==========================================================================
+// SOLUTION SINKS
+// The solver hands every full layout to a sink.  A sink also says whether
+// the caller only wants the number of solutions, in which case subtree
+// counts cached in the transposition table can stand in for the leaves.
+
+// keeps a copy of every solution, end to end in one array, until they
+// are played back (see SolutionOrder)
+class SolutionList {
+public:
+  enum { counts_only = false };
+  void add(const std::vector<Location>& locations) {
+    solutions.insert(solutions.end(), locations.begin(), locations.end());
+  }
+  std::vector<Location> solutions;
+};
+
+// keeps nothing, the solver's return value is the number of solutions
+class SolutionCounter {
+public:
+  enum { counts_only = true };
+  void add(const std::vector<Location>& locations) {}
+};
+
+// hands every solution straight to the caller's callback
+class SolutionStream {
+public:
+  SolutionStream(const SolutionCallback* c) : callback(c) {}
+  enum { counts_only = false };
+  void add(const std::vector<Location>& locations) { (*callback)(locations); }
+  const SolutionCallback* callback;
+};
+
+//==========================================================================
+// The one recursive solver behind every mode.  It takes the frontier cell
+// picked by the cell order and either fills it with each remaining tile
+// type in each allowed rotation, or leaves it empty for good (allowed
+// only when no road or city points into it).  AllowRotations,
+// StopAtFirst and Backjump are fixed at compile time, so each mode gets
+// its own inner loop with no run-time mode tests.
+//
+// Returns the number of solutions below the current layout (0 or 1 when
+// StopAtFirst).  When StopAtFirst finds a solution the placements are
+// left on the board for the caller to print; otherwise the trail is
+// rewound to where it stood on entry before returning, unless the search
+// was cancelled.  With Backjump, a return of 0 leaves the reasons in the
+// conflict row of this level.
+template <bool AllowRotations, bool StopAtFirst, bool Backjump, class Sink>
+unsigned long long Search(SearchState& s, int level, Sink& sink){
+  s.nodes++;
+  if (s.placed == s.set.numTiles()){
+    // the supply bound has already closed every road and city
+    if (!Sink::counts_only){
+      LayoutToLocations(s);
+      sink.add(s.locations);
+    }
+    return 1;
+  }
+  if (Backjump)
+    ClearConflicts(s, level);
+  if (s.head == s.tail){
+    if (Backjump)
+      AddAllConflicts(s, level);
+    return 0;
+  }
+  // a state with the same completions was already searched along
+  // another path
+  unsigned long long key = TableKey(s);
+  unsigned long long count;
+  if (s.tt.lookup(key, count) && (count==0 || Sink::counts_only)){
+    s.table_hits++;
+    if (Backjump && count==0)
+      AddAllConflicts(s, level);
+    return count;
+  }
+  count=0;
+
+  int entry = s.trail.mark();
+  int cell = ChooseCell<AllowRotations>(s);
+  Neighborhood n = GetNeighborhood(s, cell);
+  int mark = s.trail.mark();
+  for (int i=0; i<s.set.numTypes(); i++){
+    int t = s.type_order[i];
+    if (s.board.numRemaining(t) == 0){
+      if (Backjump)
+        AddPlacementConflicts(s, level, t);
+      continue;
+    }
+    const std::vector<int>& rotations = s.rotation_order[t];
+    for (int k=0; k<(AllowRotations ? rotations.size() : 1); k++){
+      if (Backjump && s.learn && Forbidden(s, level, cell, t, rotations[k]))
+        continue;
+      if (!Fits(n, s.set.type(t), rotations[k])){
+        if (Backjump){
+          int culprit = FitsCulprit(n, s.set.type(t), rotations[k]);
+          if (culprit >= 0)
+            AddConflict(s, level, culprit);
+        }
+        continue;
+      }
+      Dequeue(s);
+      Place(s, cell, t, rotations[k]);
+      if (Backjump){
+        s.level_of[cell] = level;
+        SetLevelType(s, level, t);
+      }
+      // remaining-resource bound: every road or city edge left open has to
+      // be closed by a matching side of one of the tiles not yet placed
+      if (s.board.openCities() <= s.board.remainingCities() &&
+          s.board.openRoads() <= s.board.remainingRoads()){
+        unsigned long long found = Search<AllowRotations,StopAtFirst,Backjump>(s, level+1, sink);
+        count += found;
+        if ((StopAtFirst && count>0) || Cancelled(s))
+          return count;
+        if (Backjump && found==0){
+          Learn(s, level+1, level, cell, t, rotations[k]);
+          if (count==0 && !InConflict(s, level+1, level)){
+            // this placement played no part in the failure below
+            ClearConflicts(s, level);
+            MergeConflicts(s, level);
+            Rewind(s, entry);
+            s.tt.store(key, 0);
+            return 0;
+          }
+          MergeConflicts(s, level);
+        }
+      }
+      else if (Backjump){
+        // the open edges and the supply depend on every tile placed so far
+        ClearConflicts(s, level+1);
+        AddPlacementConflicts(s, level+1, -1);
+        Learn(s, level+1, level, cell, t, rotations[k]);
+        MergeConflicts(s, level);
+      }
+      Rewind(s, mark);
+    }
+  }
+  if (!Forced(n)){
+    Dequeue(s);
+    SetStatus(s, cell, EXCLUDED);
+    if (Backjump){
+      s.level_of[cell] = level;
+      SetLevelType(s, level, -1);
+    }
+    unsigned long long found = Search<AllowRotations,StopAtFirst,Backjump>(s, level+1, sink);
+    count += found;
+    if ((StopAtFirst && count>0) || Cancelled(s))
+      return count;
+    if (Backjump && found==0){
+      if (count==0 && !InConflict(s, level+1, level))
+        ClearConflicts(s, level);
+      MergeConflicts(s, level);
+    }
+    Rewind(s, mark);
+  }
+  else if (Backjump)
+    AddConflict(s, level, ForcedCulprit(n));
+  Rewind(s, entry);
+  s.tt.store(key, count);
+  return count;
+}
+
+//==========================================================================
+// ROOT TASKS
+// The root tries each cell in turn as the first (row-major smallest)
+// cell of the layout, with the cells before it excluded so no layout is
+// found twice, and then each tile type and rotation that can go there.
+// These branches share nothing but the transposition table, so each is a
+// task that any worker thread can take.  Task i is worked out from i
+// when it is taken, so there is nothing to set aside per cell.  The
+// tasks are numbered in the order a single thread would try them, and
+// the results are put back together in that order.
+
+// Tiny all-public class naming one branch at the root.
+class RootTask {
+public:
+  RootTask(int c, int t, int r) : cell(c), type(t), rotation(r) {}
+  int cell;
+  int type;
+  int rotation;   // degrees
+};
+
+class SolutionOrder;
+
+// Tiny all-public class with what the workers share.  Tasks are handed
+// out in order through next; the (type, rotation) choices are the same
+// at every cell, so task i is choice i % choices.size() at the
+// (i / choices.size())-th cell.  The cells are taken in row-major order
+// unless a stride and offset scramble them (see RESTARTS).  In
+// first-solution mode winner is the lowest task that has found a
+// solution (NO_WINNER until then); a worker gives up once any task has
+// won, or with deterministic set only once a task ahead of its own has
+// won, which makes the solution printed the one a single thread would
+// find.  Several queues can share one winner (see PORTFOLIO), in which
+// case it only serves to stop them all.
+class TaskQueue {
+public:
+  TaskQueue(bool d, std::atomic<long long>* shared = NULL) :
+    cells(0), stride(1), offset(0), next(0), own_winner(NO_WINNER),
+    winner(shared ? shared : &own_winner), deterministic(d), order(NULL), allocations(0) {}
+  static const long long NO_WINNER = LLONG_MAX;
+  long long size() const { return (long long)cells * choices.size(); }
+  RootTask task(long long i) const {
+    const RootTask& choice = choices[i % choices.size()];
+    int cell = (offset + stride * (i / choices.size())) % cells;
+    return RootTask(cell, choice.type, choice.rotation);
+  }
+  int cells;
+  std::vector<RootTask> choices;           // (type, rotation) tried at each cell, in order
+  long long stride;                        // cells apart that tasks in a row start
+  long long offset;                        // cell of the first task
+  std::atomic<long long> next;
+  std::vector<unsigned long long> counts;  // solutions found by each worker
+  std::vector<long long> solved;           // task whose solution is on each worker's
+                                           // board, -1 if none
+  std::atomic<long long> own_winner;
+  std::atomic<long long>* winner;
+  bool deterministic;
+  SolutionOrder* order;                    // only for solutions played back in order
+  std::atomic<unsigned long long> allocations;  // made by the workers, see allocations.h
+};
+
+// the worker whose board holds the solution of the first task that
+// found one, -1 if none
+int SolvedWorker(const TaskQueue& q){
+  int best = -1;
+  for (int w=0; w<q.solved.size(); w++){
+    if (q.solved[w] >= 0 && (best < 0 || q.solved[w] < q.solved[best]))
+      best = w;
+  }
+  return best;
+}
+
+// the root choices in the order the state tries types and rotations, and
+// room for the results of that many workers, so that the search itself
+// has nothing to set aside
+void ListRootTasks(const SearchState& s, bool allow_rotations, int workers, TaskQueue& q){
+  q.cells = s.status.size();
+  q.counts.assign(workers, 0);
+  q.solved.assign(workers, -1);
+  q.choices.clear();
+  for (int i=0; i<s.set.numTypes(); i++){
+    int t = s.type_order[i];
+    const std::vector<int>& rotations = s.rotation_order[t];
+    for (int k=0; k<(allow_rotations ? rotations.size() : 1); k++)
+      q.choices.push_back(RootTask(0, t, rotations[k]));
+  }
+}
+
+//==========================================================================
+// With threads, all the solutions are still handed over in the order a
+// single thread finds them.  Each worker gathers the solutions of the
+// task it is on in a SolutionList.  When the task is over the list moves
+// here, and it is played back once every task before it is over too.
+// So solutions wait only while a task ahead of them is still running,
+// and a task that finds nothing keeps nothing.  Only the solver's own
+// thread, worker 0, plays them back, so the callback is always called on
+// that one thread.
+
+// Tiny all-public class with the tasks still running and the solutions
+// of those that are over but not played back yet, by task.  The lock
+// guards both, and the queue's next, which moves on under it.
+class SolutionOrder {
+public:
+  SolutionOrder(const SolutionCallback* c, int t) : callback(c), tiles(t) {}
+  std::mutex lock;
+  std::set<long long> running;
+  std::map<long long, std::vector<Location> > over;
+  const SolutionCallback* callback;
+  int tiles;
+};
+
+// the next task for a worker, which is running from then on
+long long TakeTask(TaskQueue& q){
+  if (q.order == NULL)
+    return q.next++;
+  std::lock_guard<std::mutex> guard(q.order->lock);
+  long long i = q.next++;
+  if (i < q.size())
+    q.order->running.insert(i);
+  return i;
+}
+
+// Plays back the solutions of the tasks that are over and have no task
+// ahead of them still running, or with all set of every task that is
+// over.  The callback is called without the lock held.
+void PlayBack(TaskQueue& q, bool all){
+  SolutionOrder& order = *q.order;
+  for (;;){
+    std::vector<Location> solutions;
+    {
+      std::lock_guard<std::mutex> guard(order.lock);
+      if (order.over.empty())
+        return;
+      std::map<long long, std::vector<Location> >::iterator first = order.over.begin();
+      long long ahead = order.running.empty() ? q.next.load() : *order.running.begin();
+      if (!all && first->first >= ahead)
+        return;
+      solutions.swap(first->second);
+      order.over.erase(first);
+    }
+    std::vector<Location> locations(order.tiles, Location(0,0,0));
+    for (size_t i=0; i<solutions.size(); i+=order.tiles){
+      std::copy(solutions.begin()+i, solutions.begin()+i+order.tiles, locations.begin());
+      (*order.callback)(locations);
+    }
+  }
+}
+
+// the end of a task for sinks that keep nothing between tasks
+template <class Sink>
+void FinishTask(TaskQueue& q, int worker, long long task, Sink& sink){}
+
+// the end of a task whose solutions wait to be played back in order
+void FinishTask(TaskQueue& q, int worker, long long task, SolutionList& list){
+  {
+    std::lock_guard<std::mutex> guard(q.order->lock);
+    q.order->running.erase(task);
+    if (!list.solutions.empty())
+      q.order->over[task].swap(list.solutions);
+  }
+  list.solutions.clear();
+  if (worker == 0)
+    PlayBack(q, false);
+}
+
+// Searches below one root branch, as level 1 of Search would.
+template <bool AllowRotations, bool StopAtFirst, bool Backjump, class Sink>
+unsigned long long SearchRootTask(SearchState& s, const RootTask& task, Sink& sink){
+  int mark = s.trail.mark();
+  s.root = task.cell;
+  Enqueue(s, task.cell);
+  unsigned long long count = 0;
+  if (Fits(GetNeighborhood(s, task.cell), s.set.type(task.type), task.rotation)){
+    Dequeue(s);
+    Place(s, task.cell, task.type, task.rotation);
+    if (Backjump){
+      s.level_of[task.cell] = 1;
+      SetLevelType(s, 1, task.type);
+    }
+    if (s.board.openCities() <= s.board.remainingCities() &&
+        s.board.openRoads() <= s.board.remainingRoads())
+      count = Search<AllowRotations,StopAtFirst,Backjump>(s, 2, sink);
+  }
+  if ((StopAtFirst && count>0) || Cancelled(s))
+    return count;
+  Rewind(s, mark);
+  return count;
+}
+
+// One worker thread: takes tasks until there are none left, until the
+// search is cancelled or, in first-solution mode, until its work can no
+// longer change the answer.
+// A worker that finds a solution stops with it still on its board.
+template <bool AllowRotations, bool StopAtFirst, bool Backjump, class Sink>
+void Work(TaskQueue& q, SearchState& s, int worker, Sink& sink){
+  s.winner = q.winner;
+  for (;;){
+    long long i = TakeTask(q);
+    if (i >= q.size())
+      return;
+    s.cancel_below = q.deterministic ? i : TaskQueue::NO_WINNER;
+    unsigned long long found = 0;
+    if (!Cancelled(s))
+      found = SearchRootTask<AllowRotations,StopAtFirst,Backjump>(s, q.task(i), sink);
+    q.counts[worker] += found;
+    FinishTask(q, worker, i, sink);
+    if (StopAtFirst && found > 0){
+      q.solved[worker] = i;
+      long long w = q.winner->load();
+      while (i < w && !q.winner->compare_exchange_weak(w, i)) {}
+      return;
+    }
+    if (Cancelled(s))
+      return;
+  }
+}
+
+// picks the specialization of the worker for the run-time rotation and
+// backjumping flags
+template <bool StopAtFirst, class Sink>
+void RunWorker(bool allow_rotations, TaskQueue& q, SearchState* s, int worker, Sink* sink){
+  if (allow_rotations){
+    if (s->backjump)
+      Work<true,StopAtFirst,true>(q, *s, worker, *sink);
+    else
+      Work<true,StopAtFirst,false>(q, *s, worker, *sink);
+  }
+  else if (s->backjump)
+    Work<false,StopAtFirst,true>(q, *s, worker, *sink);
+  else
+    Work<false,StopAtFirst,false>(q, *s, worker, *sink);
+}
+
+// a worker on a thread of its own, which counts what it allocates there
+template <bool StopAtFirst, class Sink>
+void RunThread(bool allow_rotations, TaskQueue& q, SearchState* s, int worker, Sink* sink){
+  unsigned long long before = AllocationCount();
+  RunWorker<StopAtFirst>(allow_rotations, q, s, worker, sink);
+  q.allocations += AllocationCount() - before;
+}
+
+//==========================================================================
+// Runs the root tasks with one worker per search state, each on its own
+// board and with its own sink, and returns the total number of solutions
+// found.  The calling thread is worker 0.  Everything the search
+// allocates on any thread is added to the queue's allocations, except
+// what it takes to start the other threads.
+template <bool StopAtFirst, class Sink>
+unsigned long long RunSearch(bool allow_rotations, TaskQueue& q, std::vector<SearchState*>& states,
+                             std::vector<Sink>& sinks){
+  unsigned long long before = AllocationCount();
+  assert (sinks.size() == states.size());
+  assert (q.counts.size() == states.size() && q.solved.size() == states.size());
+  std::vector<std::thread> workers;
+  unsigned long long starting = AllocationCount();
+  for (int w=1; w<states.size(); w++)
+    workers.push_back(std::thread(RunThread<StopAtFirst,Sink>, allow_rotations, std::ref(q),
+                                  states[w], w, &sinks[w]));
+  starting = AllocationCount() - starting;
+  RunWorker<StopAtFirst>(allow_rotations, q, states[0], 0, &sinks[0]);
+  for (int w=0; w<workers.size(); w++)
+    workers[w].join();
+  unsigned long long count = 0;
+  if (StopAtFirst)
+    count = SolvedWorker(q) >= 0;
+  else {
+    for (int w=0; w<q.counts.size(); w++)
+      count += q.counts[w];
+  }
+  q.allocations += AllocationCount() - before - starting;
+  return count;
+}
+
+//==========================================================================
+// PORTFOLIO
+// No one configuration of the search is fastest on every puzzle, so in
+// first-solution mode several complete solvers can race on the same
+// puzzle, each on its own thread.  Solver 0 is the default configuration;
+// the others use the cell orders in turn and try tile types and
+// rotations in an order shuffled by MTRand, seeded with the seed option
+// plus the solver's number.  The first solver to finish, with a solution
+// or with proof that there is none, stops the rest and decides the answer.
+
+// Tiny all-public class for one solver of the portfolio and how it did.
+class PortfolioEntry {
+public:
+  PortfolioEntry() : board(NULL), state(NULL), queue(NULL), seed(0), seconds(0) {}
+  Board* board;
+  SearchState* state;
+  TaskQueue* queue;
+  int seed;          // 0 for the unshuffled solver
+  double seconds;    // until it finished or was stopped
+};
+
+// shuffles the order a solver tries tile types and rotations in
+void Diversify(SearchState& s, MTRand& mtrand, bool allow_rotations){
+  for (int i=s.type_order.size()-1; i>0; i--)
+    std::swap(s.type_order[i], s.type_order[mtrand.randInt(i)]);
+  if (!allow_rotations)
+    return;
+  for (int t=0; t<s.rotation_order.size(); t++){
+    std::vector<int>& rotations = s.rotation_order[t];
+    for (int i=rotations.size()-1; i>0; i--)
+      std::swap(rotations[i], rotations[mtrand.randInt(i)]);
+  }
+}
+
+// Runs one solver; the first to finish records itself in first and
+// stops the others through the winner all their queues share.  A solver
+// only finishes with a solution, or with a search that ran to the end:
+// one stopped by another solver, a cancel or the time limit proves
+// nothing.
+void RunPortfolioEntry(bool allow_rotations, PortfolioEntry* e, int k,
+                       std::atomic<long long>* stop, std::atomic<int>* first){
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<SearchState*> states(1, e->state);
+  std::vector<SolutionCounter> sinks(1);
+  bool found = RunSearch<true>(allow_rotations, *e->queue, states, sinks);
+  if (found || (stop->load() == TaskQueue::NO_WINNER && !Stopped(*e->state))){
+    int none = -1;
+    first->compare_exchange_strong(none, k);
+    stop->store(0);
+  }
+  e->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char* CellOrderName(int order){
+  static const char* names[3] = { "queue", "fewest", "edges" };
+  return names[order];
+}
+
+// Races the solvers and returns the one that finished first, or -1 if
+// they were all stopped first.  One line per solver goes to std::cerr,
+// so wins can be tallied over many runs.
+int RunPortfolio(bool allow_rotations, std::vector<PortfolioEntry>& entries){
+  std::atomic<long long> stop(TaskQueue::NO_WINNER);
+  std::atomic<int> first(-1);
+  for (int k=0; k<entries.size(); k++)
+    entries[k].queue->winner = &stop;
+  std::vector<std::thread> solvers;
+  for (int k=0; k<entries.size(); k++)
+    solvers.push_back(std::thread(RunPortfolioEntry, allow_rotations, &entries[k], k, &stop, &first));
+  for (int k=0; k<solvers.size(); k++)
+    solvers[k].join();
+  for (int k=0; k<entries.size(); k++){
+    std::cerr << "portfolio solver " << k << " order " << CellOrderName(entries[k].state->order)
+              << " seed " << entries[k].seed << ": "
+              << (k == first ? "won" : "stopped") << " after " << entries[k].seconds << "s" << std::endl;
+  }
+  return first;
+}
+
+//==========================================================================
+// RESTARTS
+// A first-solution search can spend nearly all of its time under one bad
+// early choice.  With restarts the search gives up once it has visited a
+// set number of nodes and starts over on an empty board, with the root
+// branches, tile types and rotations in a new random order.  The limits
+// are a base times the Luby sequence (1,1,2,1,1,2,4,...) or double with
+// every run.  Dead states in the transposition table and nogoods carry
+// over, since they only come from subtrees that were searched to the
+// end.  All the randomness comes from one MTRand seeded with the seed
+// option, so a run can be repeated exactly.
+
+// Puts the start cells in a random order without listing them: the k-th
+// is offset + k*stride, wrapped around the board, with a stride that has
+// no factor in common with the number of cells so that every cell comes
+// up once.
+void ScrambleCells(TaskQueue& q, MTRand& mtrand){
+  long long a, b;
+  do {
+    q.stride = 1 + mtrand.randInt(q.cells-1);
+    for (a = q.stride, b = q.cells; b != 0; ){
+      long long r = a % b;
+      a = b;
+      b = r;
+    }
+  } while (a != 1);
+  q.offset = mtrand.randInt(q.cells-1);
+}
+
+// the i-th term (from 1) of the Luby sequence
+unsigned long long Luby(int i){
+  int k = 1;
+  while ((1 << k) - 1 < i)
+    k++;
+  if (i == (1 << k) - 1)
+    return 1ULL << (k-1);
+  return Luby(i - (1 << (k-1)) + 1);
+}
+
+// Returns true once a run finds a solution, which is left on the board,
+// and false once a run gets through the whole search under its limit, or
+// once the caller gives up.  A run the caller stopped is not a finished
+// one, however few nodes it got to visit.
+bool RunRestarts(bool allow_rotations, SearchState& s, bool luby, unsigned long long base,
+                 int seed){
+  MTRand mtrand(seed);
+  std::vector<SearchState*> states(1, &s);
+  unsigned long long total = 0;
+  for (int run = 1; ; run++){
+    s.nodes = 0;
+    // the limit stops growing at ULLONG_MAX instead of wrapping around
+    // to a small one
+    unsigned long long factor = luby ? Luby(run) : 1ULL << std::min(run-1, 40);
+    s.node_limit = base > ULLONG_MAX / factor ? ULLONG_MAX : base * factor;
+    Diversify(s, mtrand, allow_rotations);
+    TaskQueue q(false);
+    ListRootTasks(s, allow_rotations, 1, q);
+    ScrambleCells(q, mtrand);
+    std::vector<SolutionCounter> sinks(1);
+    bool found = RunSearch<true>(allow_rotations, q, states, sinks);
+    total += s.nodes;
+    if (!found && Stopped(s)){
+      std::cerr << "restarts: stopped after " << run << " runs, " << total << " nodes" << std::endl;
+      return false;
+    }
+    if (found || s.nodes < s.node_limit){
+      std::cerr << "restarts: " << run << " runs, " << total << " nodes" << std::endl;
+      return found;
+    }
+    Rewind(s, 0);
+  }
+}
+
+
+//==========================================================================
+// TIME LIMIT
+// A Watchdog sets the stop flag once the time limit has passed, unless
+// it is destroyed first.  With no limit it does nothing at all.
+class Watchdog {
+public:
+  Watchdog(std::atomic<bool>& s, double seconds) : stop(s), done(false) {
+    if (seconds > 0)
+      thread = std::thread(&Watchdog::run, this, seconds);
+  }
+  ~Watchdog() {
+    disarm();
+  }
+  // after this the flag is left alone
+  void disarm() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      done = true;
+    }
+    wake.notify_one();
+    if (thread.joinable())
+      thread.join();
+  }
+private:
+  void run(double seconds) {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    std::unique_lock<std::mutex> guard(lock);
+    while (!done) {
+      if (wake.wait_until(guard, deadline) == std::cv_status::timeout) {
+        if (!done)
+          stop = true;
+        return;
+      }
+    }
+  }
+  std::atomic<bool>& stop;
+  std::mutex lock;
+  std::condition_variable wake;
+  bool done;
+  std::thread thread;
+};
+
+
+// ==========================================================================
+// SOLVER OPTIONS
+SolverOptions::SolverOptions() :
+  allow_rotations(false), tt_megabytes(0), cell_order(ORDER_QUEUE), backjump(false),
+  nogoods(false), threads(1), deterministic(false), time_limit(0), portfolio(0),
+  restarts(RESTARTS_NONE), restart_nodes(1000), seed(0) {}
+
+
+// ==========================================================================
+// CONSTRUCTORS & DESTRUCTOR
+Solver::Solver(const std::vector<Tile*> &tiles, int rows, int columns, const SolverOptions &options) :
+  opts(options), own_set(new TileSet(tiles)), set(*own_set) {
+  init(rows, columns);
+}
+
+Solver::Solver(const TileSet &tiles, int rows, int columns, const SolverOptions &options) :
+  opts(options), own_set(NULL), set(tiles) {
+  init(rows, columns);
+}
+
+// every worker thread, or every solver of a portfolio, searches on a
+// board of its own; they all share the transposition table
+void Solver::init(int rows, int columns) {
+  assert (rows >= 1 && columns >= 1);
+  assert (opts.time_limit >= 0);
+  assert (opts.cell_order >= ORDER_QUEUE && opts.cell_order <= ORDER_EDGES);
+  assert (opts.threads >= 1 && opts.portfolio >= 0 && opts.restart_nodes >= 1);
+  assert (!opts.nogoods || opts.backjump);
+  // a portfolio runs one thread per solver, and restarts run on one thread
+  assert (opts.portfolio == 0 || (opts.threads == 1 && !opts.deterministic));
+  assert (opts.restarts == RESTARTS_NONE || (opts.threads == 1 && opts.portfolio == 0));
+  tt = new TranspositionTable(opts.tt_megabytes);
+  for (int w = 0; w < std::max(opts.threads,opts.portfolio); w++) {
+    boards.push_back(new Board(rows,columns,set));
+    states.push_back(new SearchState(*boards[w], *tt));
+  }
+  solved = NULL;
+  stop = false;
+  stopped = false;
+  reset();
+}
+
+Solver::~Solver() {
+  for (int w = 0; w < states.size(); w++) {
+    delete states[w];
+    delete boards[w];
+  }
+  delete tt;
+  delete own_set;
+}
+
+
+// ==========================================================================
+// Whatever the last call left on the boards is taken back.  The
+// transposition table and the nogoods are kept, since they only record
+// subtrees that were searched to the end.
+void Solver::reset() {
+  solved = NULL;
+  search_allocations = 0;
+  for (int w = 0; w < states.size(); w++) {
+    SearchState &s = *states[w];
+    Rewind(s, 0);
+    s.order = opts.cell_order;
+    s.backjump = opts.backjump;
+    s.learn = opts.nogoods;
+    if (s.backjump && s.conflicts.empty()) {
+      s.level_of.assign(s.status.size(), 0);
+      s.level_type.assign(s.reach+2, -1);
+      s.conflicts.assign((s.reach+3)*s.words, 0);
+      s.placement_levels.assign((set.numTypes()+1)*s.words, 0);
+    }
+    if (s.learn && s.nogood.empty())
+      s.nogood.assign(s.status.size()*set.numTypes()*4, NOGOOD_NONE);
+    s.winner = NULL;
+    s.cancel_below = LLONG_MAX;
+    s.stop = &stop;
+    s.nodes = 0;
+    s.node_limit = ULLONG_MAX;
+    for (int t = 0; t < set.numTypes(); t++) {
+      s.type_order[t] = t;
+      s.rotation_order[t] = set.type(t).distinctRotations();
+    }
+  }
+}
+
+
+// ==========================================================================
+// SOLVING
+bool Solver::solveFirst() {
+  reset();
+  Watchdog watchdog(stop, opts.time_limit);
+  if (opts.restarts != RESTARTS_NONE) {
+    if (RunRestarts(opts.allow_rotations, *states[0], opts.restarts == RESTARTS_LUBY,
+                    opts.restart_nodes, opts.seed))
+      solved = states[0];
+  }
+  else if (opts.portfolio > 0) {
+    std::vector<PortfolioEntry> entries(opts.portfolio);
+    for (int k = 0; k < opts.portfolio; k++) {
+      entries[k].board = boards[k];
+      entries[k].state = states[k];
+      if (k > 0) {
+        states[k]->order = k % 3;
+        entries[k].seed = opts.seed + k;
+        MTRand mtrand(entries[k].seed);
+        Diversify(*states[k], mtrand, opts.allow_rotations);
+      }
+      entries[k].queue = new TaskQueue(false);
+      ListRootTasks(*states[k], opts.allow_rotations, 1, *entries[k].queue);
+    }
+    int first = RunPortfolio(opts.allow_rotations, entries);
+    if (first >= 0 && SolvedWorker(*entries[first].queue) >= 0)
+      solved = entries[first].state;
+    for (int k = 0; k < opts.portfolio; k++) {
+      delete entries[k].queue;
+    }
+  }
+  else {
+    TaskQueue queue(opts.deterministic);
+    ListRootTasks(*states[0], opts.allow_rotations, opts.threads, queue);
+    std::vector<SearchState*> workers(states.begin(), states.begin()+opts.threads);
+    std::vector<SolutionCounter> first(opts.threads);
+    bool found = RunSearch<true>(opts.allow_rotations, queue, workers, first);
+    search_allocations = queue.allocations;
+    ReportSearchAllocations(search_allocations);
+    if (found)
+      solved = states[SolvedWorker(queue)];
+  }
+  finish(watchdog);
+  if (solved == NULL)
+    return false;
+  LayoutToLocations(*solved);
+  return true;
+}
+
+// With one thread the solutions are handed over as they are found.  With
+// more they are put back in order as the tasks finish (see SolutionOrder).
+unsigned long long Solver::forEachSolution(const SolutionCallback &callback) {
+  reset();
+  Watchdog watchdog(stop, opts.time_limit);
+  TaskQueue queue(false);
+  ListRootTasks(*states[0], opts.allow_rotations, opts.threads, queue);
+  std::vector<SearchState*> workers(states.begin(), states.begin()+opts.threads);
+  unsigned long long count;
+  if (opts.threads == 1) {
+    std::vector<SolutionStream> streams(1, SolutionStream(&callback));
+    count = RunSearch<false>(opts.allow_rotations, queue, workers, streams);
+  } else {
+    SolutionOrder order(&callback, set.numTiles());
+    queue.order = &order;
+    std::vector<SolutionList> lists(opts.threads);
+    count = RunSearch<false>(opts.allow_rotations, queue, workers, lists);
+    PlayBack(queue, true);
+  }
+  finish(watchdog);
+  return count;
+}
+
+unsigned long long Solver::count() {
+  reset();
+  Watchdog watchdog(stop, opts.time_limit);
+  TaskQueue queue(false);
+  ListRootTasks(*states[0], opts.allow_rotations, opts.threads, queue);
+  std::vector<SearchState*> workers(states.begin(), states.begin()+opts.threads);
+  std::vector<SolutionCounter> counters(opts.threads);
+  unsigned long long count = RunSearch<false>(opts.allow_rotations, queue, workers, counters);
+  search_allocations = queue.allocations;
+  ReportSearchAllocations(search_allocations);
+  finish(watchdog);
+  return count;
+}
+
+void Solver::finish(Watchdog &watchdog) {
+  watchdog.disarm();
+  stopped = stop.exchange(false);
+}
+
+
+// ==========================================================================
+// ACCESSORS
+const std::vector<Location>& Solver::solution() const {
+  assert (solved != NULL);
+  return solved->locations;
+}
+
+// the board of the last solution, or an empty board
+const Board& Solver::board() const {
+  if (solved != NULL)
+    return solved->board;
+  return *boards[0];
+}
+
+unsigned long long Solver::tableHits() const {
+  unsigned long long hits = 0;
+  for (int w = 0; w < states.size(); w++)
+    hits += states[w]->table_hits;
+  return hits;
+}
+
+unsigned long long Solver::searchAllocations() const {
+  return search_allocations;
+}
@@ -0,0 +1,128 @@
+#ifndef __SOLVER_H__
+#define __SOLVER_H__
+
+#include <vector>
+#include <functional>
+#include <atomic>
+
+#include "tile.h"
+#include "location.h"
+#include "board.h"
+#include "tileset.h"
+
+class SearchState;
+class TranspositionTable;
+class Watchdog;
+
+
+// which frontier cell the search decides next (see CELL ORDER in solver.cpp)
+enum { ORDER_QUEUE = 0, ORDER_FEWEST, ORDER_EDGES };
+
+// how the node limit grows between restarts
+enum { RESTARTS_NONE = 0, RESTARTS_LUBY, RESTARTS_GEOMETRIC };
+
+
+// Tiny all-public class holding the knobs of a Solver.  The defaults are
+// a plain single-threaded search without rotations.
+class SolverOptions {
+public:
+  SolverOptions();
+  bool allow_rotations;
+  int tt_megabytes;    // transposition table size, 0 = off
+  int cell_order;      // ORDER_QUEUE, ORDER_FEWEST or ORDER_EDGES
+  bool backjump;
+  bool nogoods;        // needs backjump
+  int threads;         // worker threads, at least 1
+  bool deterministic;  // solveFirst finds what one thread would
+  double time_limit;   // seconds each call may take, 0 = no limit
+  // the options below only apply to solveFirst
+  int portfolio;       // number of solvers to race, 0 = off
+  int restarts;        // RESTARTS_NONE, RESTARTS_LUBY or RESTARTS_GEOMETRIC
+  int restart_nodes;   // node limit of the first restart
+  int seed;            // for the portfolio and restarts
+};
+
+
+// called with one Location per input tile for every solution
+typedef std::function<void (const std::vector<Location>&)> SolutionCallback;
+
+
+// This class places a set of tiles on a board of a given size so that
+// every road and city edge is matched, and no tile is left over.  It
+// only reads the tiles, which must outlive it.  The same Solver can be
+// asked any number of questions; whatever it learns about dead ends is
+// kept from one to the next.  A call that runs past the time limit, or
+// is cancelled from another thread, stops early and its answer is not
+// to be trusted (see cancelled).
+
+class Solver {
+public:
+
+  // CONSTRUCTORS & DESTRUCTOR
+  Solver(const std::vector<Tile*> &tiles, int rows, int columns,
+         const SolverOptions &options = SolverOptions());
+  // shares a tile set built by the caller, which must outlive the solver
+  Solver(const TileSet &tiles, int rows, int columns,
+         const SolverOptions &options = SolverOptions());
+  ~Solver();
+
+  // SOLVING
+  // looks for one solution, true if there is one
+  bool solveFirst();
+  // calls back with every solution in the order a single thread finds
+  // them and returns how many there are
+  unsigned long long forEachSolution(const SolutionCallback &callback);
+  // the number of solutions
+  unsigned long long count();
+  // stops the call in progress, or the next call if none is running;
+  // safe from any thread
+  void cancel() { stop = true; }
+
+  // ACCESSORS
+  // the solution found by the last successful solveFirst, and the board
+  // it is laid out on (until the next call to one of the above)
+  const std::vector<Location>& solution() const;
+  const Board& board() const;
+  const TileSet& tileSet() const { return set; }
+  const SolverOptions& options() const { return opts; }
+  // did the last call stop early?  (a solution solveFirst found is
+  // good either way)
+  bool cancelled() const { return stopped; }
+  // how many subtrees the transposition table has answered for, over
+  // every call so far
+  unsigned long long tableHits() const;
+  // heap allocations the workers made while they searched in the last
+  // count, or solveFirst without a portfolio or restarts; always 0 unless
+  // built with COUNT_ALLOCATIONS (see allocations.h)
+  unsigned long long searchAllocations() const;
+
+private:
+
+  // helper for the constructors
+  void init(int rows, int columns);
+  // puts every search state back on an empty board with the options' order
+  void reset();
+  // ends a call once the search is over: the time limit no longer
+  // applies, and a cancel from now on is for the next call
+  void finish(Watchdog &watchdog);
+
+  // the solver holds pointers to itself, so it must not be copied
+  Solver(const Solver&);
+  Solver& operator=(const Solver&);
+
+  // REPRESENTATION
+  SolverOptions opts;
+  TileSet *own_set;      // NULL if the tile set belongs to the caller
+  const TileSet &set;
+  TranspositionTable *tt;
+  // one board and search state per worker thread or portfolio solver
+  std::vector<Board*> boards;
+  std::vector<SearchState*> states;
+  SearchState *solved;   // the state holding the last solution, or NULL
+  std::atomic<bool> stop;
+  bool stopped;          // the last call stopped early
+  unsigned long long search_allocations;
+};
+
+
+#endif
@@ -2,6 +2,8 @@
 #include <cassert>
 #include <vector>
 #include <string>
+#include <map>
+#include <mutex>
 #include "tile.h"
 
 
@@ -10,12 +12,6 @@
 #define CITY_CHAR '.'
 
 
-// ==========================================================================
-// this global variable is set in main.cpp and is adjustable from the command line
-// (you are not allowed to make your own global variables)
-extern int GLOBAL_TILE_SIZE;
-
-
 // ==========================================================================
 // CONSTRUCTOR
 // takes in 4 strings, checks the legality of the labeling 
@@ -40,6 +36,23 @@ Tile::Tile(const std::string &north, const std::string &east,
   if (south_ == "road") num_roads++;
   if (east_ == "road") num_roads++;
   if (west_ == "road") num_roads++;
+
+  // remember which sides must be closed by a neighboring tile
+  open_edges_ = 0;
+  if (north_ != "pasture") open_edges_ |= NORTH_EDGE;
+  if (east_  != "pasture") open_edges_ |= EAST_EDGE;
+  if (south_ != "pasture") open_edges_ |= SOUTH_EDGE;
+  if (west_  != "pasture") open_edges_ |= WEST_EDGE;
+  city_edges_ = 0;
+  if (north_ == "city") city_edges_ |= NORTH_EDGE;
+  if (east_  == "city") city_edges_ |= EAST_EDGE;
+  if (south_ == "city") city_edges_ |= SOUTH_EDGE;
+  if (west_  == "city") city_edges_ |= WEST_EDGE;
+  signature_ = 0;
+  const std::string* sides[4] = { &north_, &east_, &south_, &west_ };
+  for (int s = 0; s < 4; s++) {
+    signature_ = signature_*3 + (*sides[s] == "road" ? 1 : (*sides[s] == "city" ? 2 : 0));
+  }
   
   // For our version of Carcassonne, we put these restrictions on the
   // tile edge labeling:
@@ -49,61 +62,116 @@ Tile::Tile(const std::string &north, const std::string &east,
   if (num_roads == 2 && num_cities == 2) {
     assert (north_ == east_ || north_ == west_);
   }
+}
 
-  // pre-compute the ASCII art center of the tile
-  prepare_ascii_art();
+// the same checks as the constructor, for input that cannot be trusted
+bool Tile::legal(const std::string &north, const std::string &east,
+                 const std::string &south, const std::string &west) {
+  const std::string* sides[4] = { &north, &east, &south, &west };
+  int num_cities = 0;
+  int num_roads = 0;
+  for (int s = 0; s < 4; s++) {
+    if (*sides[s] == "city") num_cities++;
+    else if (*sides[s] == "road") num_roads++;
+    else if (*sides[s] != "pasture") return false;
+  }
+  if (num_roads == 1 && num_cities != 0 && num_cities != 3) return false;
+  if (num_roads == 2 && num_cities == 2 && north != east && north != west) return false;
+  return true;
 }
 
-Tile Tile::rotate(int a) {
+Tile Tile::rotate(int a) const {
   assert(a==90|| a==180||a==0||a==270);
   if (a==90){
-    rotation_=90;
     return Tile(west_, north_, east_, south_);
   }
   else if (a==180){
-    rotation_=180;
     return Tile(south_, west_, north_, east_);
   }
   else if (a==270){
-    rotation_=270;
     return Tile(east_, south_, west_, north_);
   }
   else{
-    rotation_=0;
     return Tile(north_, east_, south_, west_);
   }
 }
+// ==========================================================================
+// a clockwise quarter turn moves each side bit one place up (west wraps
+// around to north), matching the edge shuffle done by rotate()
+int Tile::rotateMask(int mask, int rotation) {
+  assert (rotation == 0 || rotation == 90 || rotation == 180 || rotation == 270);
+  for (int r = 0; r < rotation; r += 90) {
+    mask = ((mask << 1) | (mask >> 3)) & 15;
+  }
+  return mask;
+}
+
+int Tile::openEdges(int rotation) const {
+  return rotateMask(open_edges_, rotation);
+}
+
+int Tile::cityEdges(int rotation) const {
+  return rotateMask(city_edges_, rotation);
+}
+
 // ==========================================================================
 // print one row of the tile at a time 
 // (allows a whole board of tiles to be printed)
-void Tile::printRow(std::ostream &ostr, int row) const {
+void Tile::printRow(std::ostream &ostr, const RenderContext &context, int row, int rotation) const {
+  int size = context.tile_size;
   // must be a legal row for this tile size
-  assert (row >= 0 && row < GLOBAL_TILE_SIZE);
+  assert (row >= 0 && row < size);
 
-  if (row == 0 || row == GLOBAL_TILE_SIZE-1) {
-    ostr << '+' << std::string(GLOBAL_TILE_SIZE-2,'-') << '+';
+  if (row == 0 || row == size-1) {
+    ostr << '+' << std::string(size-2,'-') << '+';
   } else {
-    ostr << '|' << ascii_art[row-1] << '|';
+    ostr << '|' << getAsciiArt(context,rotation)[row-1] << '|';
+  }
+}
+
+
+// ==========================================================================
+// Only 81 edge signatures exist, so the art is interned in one table for
+// the whole process, keyed by (signature, rotation, tile size).  Entries
+// of a std::map never move, so the returned reference stays valid.
+const std::vector<std::string>& Tile::getAsciiArt(const RenderContext &context, int rotation) const {
+  static std::mutex cache_lock;
+  static std::map<std::pair<int,int>, std::vector<std::string> > cache;
+
+  assert (rotation == 0 || rotation == 90 || rotation == 180 || rotation == 270);
+  std::pair<int,int> key(signature_*4 + rotation/90, context.tile_size);
+  std::lock_guard<std::mutex> guard(cache_lock);
+  std::map<std::pair<int,int>, std::vector<std::string> >::iterator itr = cache.find(key);
+  if (itr == cache.end()) {
+    // a clockwise quarter turn moves each side one place around
+    const std::string* sides[4] = { &north_, &east_, &south_, &west_ };
+    int r = rotation/90;
+    itr = cache.insert(std::make_pair(key, std::vector<std::string>())).first;
+    prepare_ascii_art(*sides[(4-r)%4], *sides[(5-r)%4], *sides[(6-r)%4], *sides[(7-r)%4],
+                      context.tile_size, itr->second);
   }
+  return itr->second;
 }
 
 
 // ==========================================================================
 // long, messy, uninteresting function that
 // prepares the inner block of ASCII art for the tile
-void Tile::prepare_ascii_art() {
+void Tile::prepare_ascii_art(const std::string &north, const std::string &east,
+                             const std::string &south, const std::string &west,
+                             int tile_size, std::vector<std::string> &ascii_art) {
 
-  // tiles have to be odd sized
-  assert (GLOBAL_TILE_SIZE % 2 == 1);
-  // tiles must be big enough to the ascii art is visible
-  assert (GLOBAL_TILE_SIZE >= 11);
+  // tiles have to be odd sized and big enough to the ascii art is visible
+  assert (RenderContext::validTileSize(tile_size));
 
   // helper variables
-  int inner_size = GLOBAL_TILE_SIZE-2;
+  int inner_size = tile_size-2;
   int half = inner_size/2;
   int city_depth = (half+2) / 2;
   assert (city_depth >= 3);
   int road_curve = city_depth-1;
+  int num_cities = (north == "city") + (east == "city") + (south == "city") + (west == "city");
+  int num_roads = (north == "road") + (east == "road") + (south == "road") + (west == "road");
   ascii_art = std::vector<std::string>(inner_size,std::string(inner_size,' '));
 
   // -------------------------------------------------------------------
@@ -111,14 +179,14 @@ void Tile::prepare_ascii_art() {
 
   // Does a road go straight vertically or horizontally through the tile?
   bool center_road = false;
-  if ((north_ == "road" && south_ == "road") ||
-       (east_ == "road" && west_ == "road")) {
+  if ((north == "road" && south == "road") ||
+       (east == "road" && west == "road")) {
     center_road = true;
     ascii_art[half][half] = ROAD_CHAR;
   }
 
   // Construct the road fragments from edge towards the center of the tile
-  if (north_ == "road") {
+  if (north == "road") {
     for (int i = 0; i < half-1; i++) {
       ascii_art[i][half] = ROAD_CHAR;
     }
@@ -126,7 +194,7 @@ void Tile::prepare_ascii_art() {
       ascii_art[half-1][half] = ROAD_CHAR;
     }
   }
-  if (south_ == "road") {
+  if (south == "road") {
     for (int i = half+2; i < inner_size; i++) {
       ascii_art[i][half] = ROAD_CHAR;
     }
@@ -134,7 +202,7 @@ void Tile::prepare_ascii_art() {
         ascii_art[half+1][half] = ROAD_CHAR;
     }
   }
-  if (west_ == "road") {
+  if (west == "road") {
     for (int i = 0; i < half-1; i++) {
       ascii_art[half][i] = ROAD_CHAR;
     }
@@ -142,7 +210,7 @@ void Tile::prepare_ascii_art() {
       ascii_art[half][half-1] = ROAD_CHAR;
     }
   }
-  if (east_ == "road") {
+  if (east == "road") {
     for (int i = half+2; i < inner_size; i++) {
       ascii_art[half][i] = ROAD_CHAR;
     }
@@ -153,7 +221,7 @@ void Tile::prepare_ascii_art() {
 
   // Construct the curved pieces of "corner" roads
   if (!center_road) {
-    if (north_ == "road" && east_ == "road") {
+    if (north == "road" && east == "road") {
       for (int c = 1; c < road_curve; c++) {
         ascii_art[half-c][half+road_curve-c] = ROAD_CHAR;
         ascii_art[half-c][half+road_curve-c] = ROAD_CHAR;
@@ -161,7 +229,7 @@ void Tile::prepare_ascii_art() {
         ascii_art[half][half+road_curve-c] = ' ';
       }
     }
-    if (east_ == "road" && south_ == "road") {
+    if (east == "road" && south == "road") {
       for (int c = 1; c < road_curve; c++) {
         ascii_art[half+c][half+road_curve-c] = ROAD_CHAR;
         ascii_art[half+c][half+road_curve-c] = ROAD_CHAR;
@@ -169,7 +237,7 @@ void Tile::prepare_ascii_art() {
         ascii_art[half][half+road_curve-c] = ' ';
       }
     }
-    if (south_ == "road" && west_ == "road") {
+    if (south == "road" && west == "road") {
       for (int c = 1; c < road_curve; c++) {
         ascii_art[half+c][half-road_curve+c] = ROAD_CHAR;
         ascii_art[half+c][half-road_curve+c] = ROAD_CHAR;
@@ -177,7 +245,7 @@ void Tile::prepare_ascii_art() {
         ascii_art[half][half-road_curve+c] = ' ';
       }
     }
-    if (west_ == "road" && north_ == "road") {
+    if (west == "road" && north == "road") {
       for (int c = 1; c < road_curve; c++) {
         ascii_art[half-c][half-road_curve+c] = ROAD_CHAR;
         ascii_art[half-c][half-road_curve+c] = ROAD_CHAR;
@@ -191,9 +259,9 @@ void Tile::prepare_ascii_art() {
   // -------------------------------------------------------------------
   // CITIES
   // construct the curved wedges of cities for each edge
-  if (north_ == "city") {
+  if (north == "city") {
     int depth = city_depth;
-    if (east_ == "city" || west_ == "city") {
+    if (east == "city" || west == "city") {
       depth = half;
     }
     for (int i = 0; i < depth; i++) {
@@ -202,20 +270,20 @@ void Tile::prepare_ascii_art() {
       }
     }
   }
-  if (south_ == "city") {
+  if (south == "city") {
     int depth = city_depth;
-    if (east_ == "city" || west_ == "city") {
+    if (east == "city" || west == "city") {
       depth = half;
     }
     for (int i = 0; i < depth; i++) {
       for (int j = i+1; j < inner_size-i-1; j++) {
-        ascii_art[GLOBAL_TILE_SIZE-3-i][j] = CITY_CHAR;
+        ascii_art[tile_size-3-i][j] = CITY_CHAR;
       }
     }
   }
-  if (west_ == "city") {
+  if (west == "city") {
     int depth = city_depth;
-    if (north_ == "city" || south_ == "city") {
+    if (north == "city" || south == "city") {
       depth = half;
     }
     for (int i = 0; i < depth; i++) {
@@ -224,14 +292,14 @@ void Tile::prepare_ascii_art() {
       }
     }
   }
-  if (east_ == "city") {
+  if (east == "city") {
     int depth = city_depth;
-    if (north_ == "city" || south_ == "city") {
+    if (north == "city" || south == "city") {
       depth = half;
     }
     for (int i = 0; i < depth; i++) {
       for (int j = i+1; j < inner_size-i-1; j++) {
-        ascii_art[j][GLOBAL_TILE_SIZE-3-i] = CITY_CHAR;
+        ascii_art[j][tile_size-3-i] = CITY_CHAR;
       }
     }
   }
@@ -246,30 +314,30 @@ void Tile::prepare_ascii_art() {
   } 
 
   // If there are 2 neighboring wedges of city, fill in the gap
-  if (north_ == "city" && west_ == "city") {
+  if (north == "city" && west == "city") {
     for (int i = 0; i < half; i++) {
       ascii_art[i][i] = CITY_CHAR;
     }
   }
-  if (north_ == "city" && east_ == "city") {
+  if (north == "city" && east == "city") {
     for (int i = 0; i < half; i++) {
-      ascii_art[i][GLOBAL_TILE_SIZE-3-i] = CITY_CHAR;
+      ascii_art[i][tile_size-3-i] = CITY_CHAR;
     }
   }
-  if (south_ == "city" && west_ == "city") {
+  if (south == "city" && west == "city") {
     for (int i = 0; i < half; i++) {
-      ascii_art[GLOBAL_TILE_SIZE-3-i][i] = CITY_CHAR;
+      ascii_art[tile_size-3-i][i] = CITY_CHAR;
     }
   }
-  if (south_ == "city" && east_ == "city") {
+  if (south == "city" && east == "city") {
     for (int i = 0; i < half; i++) {
-      ascii_art[GLOBAL_TILE_SIZE-3-i][GLOBAL_TILE_SIZE-3-i] = CITY_CHAR;
+      ascii_art[tile_size-3-i][tile_size-3-i] = CITY_CHAR;
     }
   }
   
   // -------------------------------------------------------------------
   // DRAW THE ABBEY BUILDING
-  if (hasAbbey()) {
+  if (num_cities == 0 && num_roads <= 1) {
     ascii_art[half-2][half] = '^';
     ascii_art[half-1][half-1] = '/';
     ascii_art[half-1][half  ] = ' ';
@@ -6,8 +6,29 @@
 #include <vector>
 
 
+// Bits used to describe a set of tile sides (or board cell sides)
+enum { NORTH_EDGE = 1, EAST_EDGE = 2, SOUTH_EDGE = 4, WEST_EDGE = 8 };
+
+
+// Tiny all-public class with the settings the ASCII art is drawn with.
+// Whoever prints passes one along, so boards can be drawn at different
+// sizes on different threads at the same time.
+class RenderContext {
+public:
+  RenderContext(int size = DEFAULT_TILE_SIZE) : tile_size(size) {}
+  enum { DEFAULT_TILE_SIZE = 11 };
+  // tiles have to be odd sized and big enough for the art to be visible
+  static bool validTileSize(int size) { return size >= 11 && size % 2 == 1; }
+  int tile_size;   // characters along each side of a tile, border included
+};
+
+
 // This class represents a single Carcassonne tile and includes code
 // to produce a human-readable ASCII art representation of the tile.
+// The art is not stored in the tile: it is built the first time a tile
+// with the same edges, rotation and size is printed, and shared from then on.
+// Tiles never change after construction; how a tile is turned on the
+// board is recorded by the board (see Placement), not by the tile.
 
 class Tile {
 public:
@@ -15,24 +36,41 @@ public:
   // Constructor takes in 4 strings, representing what is on the edge
   // of each tile.  Each edge string is "pasture", "road", or "city".
   Tile(const std::string &north, const std::string &east, const std::string &south, const std::string &west);
+  // would the constructor accept these edges?
+  static bool legal(const std::string &north, const std::string &east,
+                    const std::string &south, const std::string &west);
 
   // ACCESSORS
   const std::string& getNorth() const { return north_; }
   const std::string& getSouth() const { return south_; }
   const std::string& getEast() const { return east_; }
   const std::string& getWest() const { return west_; }
-  const int& getRotation() const {return rotation_;}
+  // the edge signature, a base-3 number with one digit per side
+  // (pasture = 0, road = 1, city = 2); there are 81 possible types
+  int signature() const { return signature_; }
   int numCities() const { return num_cities; }
   int numRoads() const { return num_roads; }
   int hasAbbey() const { return (num_cities == 0 && num_roads <= 1); }
-  Tile rotate(int a);
-  // for ASCII art printing
-  void printRow(std::ostream &ostr, int i) const;
+  // bitmask of the road & city (non-pasture) sides after rotating the
+  // tile clockwise by the given angle
+  int openEdges(int rotation) const;
+  // bitmask of the city sides after the same rotation
+  int cityEdges(int rotation) const;
+  // a copy of the tile turned clockwise by a degrees
+  Tile rotate(int a) const;
+  // for ASCII art printing, row i of the tile turned by rotation
+  void printRow(std::ostream &ostr, const RenderContext &context, int i, int rotation = 0) const;
+  // the inner block of the art (without the border)
+  const std::vector<std::string>& getAsciiArt(const RenderContext &context, int rotation) const;
 
 private:
 
-  // helper function called by the constructor for printing
-  void prepare_ascii_art();
+  // helper function that draws the inner block of art for a set of edges
+  static void prepare_ascii_art(const std::string &north, const std::string &east,
+                                const std::string &south, const std::string &west,
+                                int tile_size, std::vector<std::string> &ascii_art);
+  // turns a side bitmask clockwise by the given angle
+  static int rotateMask(int mask, int rotation);
 
   // REPRESENTATION
   std::string north_;
@@ -41,8 +79,9 @@ private:
   std::string west_;
   int num_roads;
   int num_cities;
-  int rotation_;
-  std::vector<std::string> ascii_art;
+  int open_edges_;
+  int city_edges_;
+  int signature_;
 };
 
 
@@ -0,0 +1,45 @@
+#include <cassert>
+
+#include "tileset.h"
+
+
+// ==========================================================================
+// TILE TYPE
+TileType::TileType(Tile *example) : example_(example) {
+  assert (example != NULL);
+  for (int r = 0; r < 4; r++) {
+    open_[r] = example->openEdges(r*90);
+    city_[r] = example->cityEdges(r*90);
+  }
+  // skip rotations that repeat an earlier edge layout
+  for (int r = 0; r < 4; r++) {
+    bool repeat = false;
+    for (int k = 0; k < r; k++) {
+      if (open_[k] == open_[r] && city_[k] == city_[r]) repeat = true;
+    }
+    if (!repeat) distinct_.push_back(r*90);
+  }
+}
+
+
+// ==========================================================================
+// TILE SET
+// types are numbered in order of first appearance in the input
+TileSet::TileSet(const std::vector<Tile*> &tiles) {
+  std::vector<int> id_of_signature(81,-1);
+  for (int i = 0; i < tiles.size(); i++) {
+    int sig = tiles[i]->signature();
+    if (id_of_signature[sig] == -1) {
+      id_of_signature[sig] = types.size();
+      types.push_back(TileType(tiles[i]));
+      counts_.push_back(0);
+      members.push_back(std::vector<int>());
+    }
+    int t = id_of_signature[sig];
+    type_of.push_back(t);
+    counts_[t]++;
+    members[t].push_back(i);
+  }
+}
+
+// ==========================================================================
@@ -0,0 +1,73 @@
+#ifndef __TILESET_H__
+#define __TILESET_H__
+
+#include <vector>
+#include "tile.h"
+
+
+// A TileType is the shared, immutable description of every tile with the
+// same four edges (at most 81 types exist).  The edge masks of all four
+// rotations are computed once when the type is created, so the solver
+// never has to rotate or compare strings.
+
+class TileType {
+public:
+
+  // CONSTRUCTOR
+  // takes in any tile of this type, which is kept for printing
+  TileType(Tile *example);
+
+  // ACCESSORS
+  int signature() const { return example_->signature(); }
+  Tile* example() const { return example_; }
+  int numCities() const { return example_->numCities(); }
+  int numRoads() const { return example_->numRoads(); }
+  // rotation is 0, 90, 180 or 270 (as in Location)
+  int openEdges(int rotation) const { return open_[rotation/90]; }
+  int cityEdges(int rotation) const { return city_[rotation/90]; }
+  // the rotations that produce different edge layouts, smallest first
+  // (a four-way road crossing has only one)
+  const std::vector<int>& distinctRotations() const { return distinct_; }
+
+private:
+
+  // REPRESENTATION
+  Tile *example_;
+  int open_[4];
+  int city_[4];
+  std::vector<int> distinct_;
+};
+
+
+// A TileSet interns the tiles read from the puzzle file into types:
+// which type each input tile is, and how many tiles of each type there
+// are.  The solver works on the small type ids and the count vector.
+
+class TileSet {
+public:
+
+  // CONSTRUCTOR
+  TileSet(const std::vector<Tile*> &tiles);
+
+  // ACCESSORS
+  int numTiles() const { return type_of.size(); }
+  int numTypes() const { return types.size(); }
+  const TileType& type(int t) const { return types[t]; }
+  // type id of input tile i
+  int typeOf(int i) const { return type_of[i]; }
+  // number of tiles of each type
+  const std::vector<int>& counts() const { return counts_; }
+  // input tile indices of type t, in input order
+  const std::vector<int>& tilesOfType(int t) const { return members[t]; }
+
+private:
+
+  // REPRESENTATION
+  std::vector<TileType> types;
+  std::vector<int> type_of;
+  std::vector<int> counts_;
+  std::vector<std::vector<int> > members;
+};
+
+
+#endif
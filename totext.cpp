@@ -0,0 +1,48 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "solutionfile.h"
+
+
+// ==========================================================================
+// Turns a solution file written with -binary_output back into the text
+// the solver prints with -all_solutions, line for line.
+void usage(int argc, char *argv[]) {
+  std::cerr << "USAGE: " << std::endl;
+  std::cerr << "  " << argv[0] << " <solution file>" << std::endl;
+  exit(1);
+}
+
+
+// ==========================================================================
+int main(int argc, char *argv[]) {
+
+  if (argc != 2) {
+    usage(argc,argv);
+  }
+  SolutionReader reader;
+  std::string error;
+  if (!reader.open(argv[1], error)) {
+    std::cerr << "ERROR: " << error << std::endl;
+    usage(argc,argv);
+  }
+
+  if (reader.numSolutions() == 0) {
+    std::cout << "did not find a solution" << std::endl;
+    return 0;
+  }
+  std::cout << "found " << reader.numSolutions() << " solutions." << '\n';
+  std::vector<Location> solution;
+  while (reader.next(solution)) {
+    std::cout << "This is a solution: ";
+    for (int i = 0; i < solution.size(); i++) {
+      std::cout << solution[i];
+    }
+    std::cout << '\n';
+  }
+  std::cout.flush();
+  return 0;
+}
+// ==========================================================================
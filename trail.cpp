@@ -0,0 +1,12 @@
+#include <cassert>
+
+#include "trail.h"
+
+
+// ==========================================================================
+// CONSTRUCTOR
+// the vector still grows if the guess was short, it just costs a copy
+Trail::Trail(int capacity) {
+  assert (capacity >= 0);
+  entries.reserve(capacity);
+}
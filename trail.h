@@ -0,0 +1,51 @@
+#ifndef __TRAIL_H__
+#define __TRAIL_H__
+
+#include <vector>
+
+
+// Tiny all-public class for one record on the trail: what kind of
+// change was made, where it was made, and the value it overwrote.  The
+// meaning of kind and where is up to whoever pushes the record.
+class TrailEntry {
+public:
+  TrailEntry(int k, int w, int o) : kind(k), where(w), old(o) {}
+  int kind;
+  int where;
+  int old;
+};
+
+
+// Undo log for a backtracking search.  Every change to the search state
+// pushes a record of the value it replaced.  A choice point takes a
+// mark() before trying its options, and backtracking pops the records
+// above the mark and puts the old values back, so undoing a branch costs
+// as much as the changes made in it and nothing more.
+
+class Trail {
+public:
+
+  // CONSTRUCTOR
+  // takes in the number of records to make room for up front
+  Trail(int capacity);
+
+  // ACCESSORS
+  int mark() const { return entries.size(); }
+  bool above(int mark) const { return (int)entries.size() > mark; }
+
+  // MODIFIERS
+  void push(int kind, int where, int old) { entries.push_back(TrailEntry(kind,where,old)); }
+  TrailEntry pop() {
+    TrailEntry e = entries.back();
+    entries.pop_back();
+    return e;
+  }
+
+private:
+
+  // REPRESENTATION
+  std::vector<TrailEntry> entries;
+};
+
+
+#endif
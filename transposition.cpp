@@ -0,0 +1,50 @@
+#include <cassert>
+
+#include "transposition.h"
+
+
+// ==========================================================================
+// CONSTRUCTOR
+// the slot count is the largest power of two that fits in the budget
+TranspositionTable::TranspositionTable(int megabytes) : mask(0) {
+  assert (megabytes >= 0);
+  if (megabytes == 0) return;
+  unsigned long long slots = 1;
+  while (2*slots*sizeof(Entry) <= (unsigned long long)megabytes << 20) {
+    slots *= 2;
+  }
+  table = std::vector<Entry>(slots);
+  mask = slots-1;
+}
+
+
+// ==========================================================================
+// ACCESSORS
+// the low bit of the data word marks a slot in use, the rest is the count
+bool TranspositionTable::lookup(unsigned long long key, unsigned long long &count) const {
+  if (table.empty()) return false;
+  const Entry &e = table[key & mask];
+  unsigned long long data = e.data.load(std::memory_order_relaxed);
+  unsigned long long check = e.check.load(std::memory_order_relaxed);
+  if ((data & 1) == 0 || (check ^ data) != key) return false;
+  count = data >> 1;
+  return true;
+}
+
+bool TranspositionTable::isDead(unsigned long long key) const {
+  unsigned long long count;
+  return lookup(key,count) && count == 0;
+}
+
+
+// ==========================================================================
+// MODIFIERS
+void TranspositionTable::store(unsigned long long key, unsigned long long count) {
+  if (table.empty()) return;
+  Entry &e = table[key & mask];
+  unsigned long long data = (count << 1) | 1;
+  e.data.store(data, std::memory_order_relaxed);
+  e.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+// ==========================================================================
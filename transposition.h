@@ -0,0 +1,47 @@
+#ifndef __TRANSPOSITION_H__
+#define __TRANSPOSITION_H__
+
+#include <atomic>
+#include <vector>
+
+
+// Fixed-size hash table of search results, indexed by a Zobrist hash of
+// what a partial layout leaves open (see TABLE KEY in solver.cpp).  A
+// stored count of 0 marks a proven-dead state; in count mode the number
+// of completions below the state is stored instead.
+//
+// The table never grows: a new entry simply overwrites whatever shared
+// its slot.  Each slot holds the data word and (key XOR data), so a
+// reader that races with a writer sees a key mismatch rather than a
+// torn entry, and no locks are needed.
+
+class TranspositionTable {
+public:
+
+  // CONSTRUCTOR
+  // takes in the memory cap in megabytes, 0 disables the table
+  TranspositionTable(int megabytes);
+
+  // ACCESSORS
+  bool enabled() const { return !table.empty(); }
+  bool lookup(unsigned long long key, unsigned long long &count) const;
+  bool isDead(unsigned long long key) const;
+
+  // MODIFIERS
+  void store(unsigned long long key, unsigned long long count);
+  void storeDead(unsigned long long key) { store(key,0); }
+
+private:
+
+  struct Entry {
+    std::atomic<unsigned long long> check;
+    std::atomic<unsigned long long> data;
+  };
+
+  // REPRESENTATION
+  std::vector<Entry> table;
+  unsigned long long mask;
+};
+
+
+#endif
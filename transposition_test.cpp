@@ -0,0 +1,83 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "solver.h"
+#include "puzzlefile.h"
+
+
+// ==========================================================================
+// Checks that the transposition table is used: with rotations, the same
+// tiles turned different ways in the middle of a layout leave the same
+// edge for the rest of the search, so counting hits the table, and the
+// counts must come out as they do without it.  Run by make check.
+
+// puzzle2.txt
+static const char *puzzle =
+  "tile road road road road\n"
+  "tile road road road pasture\n"
+  "tile pasture road road road\n"
+  "tile road pasture road road\n"
+  "tile road road pasture road\n"
+  "tile road road pasture pasture\n"
+  "tile pasture road road pasture\n"
+  "tile pasture pasture road road\n"
+  "tile road pasture pasture road\n";
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+// counts the solutions with and without a table, with every search the
+// options allow, and checks the table was hit
+void checkCounts(const std::vector<Tile*> &tiles, int rows, int columns,
+                 SolverOptions options, const std::string &name) {
+  options.allow_rotations = true;
+  options.tt_megabytes = 0;
+  Solver plain(tiles, rows, columns, options);
+  unsigned long long expected = plain.count();
+  check(plain.tableHits() == 0, name + ": no table, no hits");
+
+  options.tt_megabytes = 4;
+  Solver counter(tiles, rows, columns, options);
+  check(counter.count() == expected, name + ": count with the table");
+  check(counter.tableHits() > 0, name + ": the table is hit when counting");
+
+  Solver lister(tiles, rows, columns, options);
+  unsigned long long listed = 0;
+  unsigned long long returned = lister.forEachSolution(
+    [&listed](const std::vector<Location>&) { listed++; });
+  check(listed == expected && returned == expected, name + ": every solution with the table");
+}
+
+
+// ==========================================================================
+int main() {
+  std::vector<Tile*> tiles;
+  std::string error;
+  if (!ParsePuzzle(puzzle, tiles, error)) {
+    std::cerr << "ERROR: " << error << std::endl;
+    return 1;
+  }
+
+  SolverOptions options;
+  checkCounts(tiles, 3, 3, options, "3x3");
+  checkCounts(tiles, 4, 5, options, "4x5");
+  options.backjump = options.nogoods = true;
+  checkCounts(tiles, 4, 4, options, "4x4 with nogoods");
+  options.backjump = options.nogoods = false;
+  options.threads = 3;
+  checkCounts(tiles, 4, 4, options, "4x4 on 3 threads");
+
+  for (int t = 0; t < tiles.size(); t++)
+    delete tiles[t];
+  if (failures > 0)
+    return 1;
+  std::cout << "transposition table: ok" << std::endl;
+  return 0;
+}